@@ -0,0 +1,245 @@
+/*
+ * Copyright (C) 2014 Collabora Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#include "config.h"
+
+#include "activity.h"
+
+enum {
+  PROP_0,
+  PROP_ACTIVE,
+};
+
+/* an idle callback which is only allowed to run while the output is
+ * active. while the output is idle the GSource is removed and only
+ * the callback is kept so it can be queued again on wake. */
+typedef struct {
+  MaynardActivity *activity;
+  guint id;
+  guint source_id;
+  GSourceFunc function;
+  gpointer data;
+} ActivityIdle;
+
+struct MaynardActivityPrivate {
+  gboolean active;
+
+  /* guint id -> ActivityIdle */
+  GHashTable *idles;
+  guint next_idle_id;
+
+  guint deferred_idles;
+  guint avoided_wakeups;
+};
+
+G_DEFINE_TYPE(MaynardActivity, maynard_activity, G_TYPE_OBJECT)
+
+static void
+activity_idle_free (gpointer data)
+{
+  ActivityIdle *idle = data;
+
+  if (idle->source_id > 0)
+    g_source_remove (idle->source_id);
+
+  g_slice_free (ActivityIdle, idle);
+}
+
+static void
+maynard_activity_init (MaynardActivity *self)
+{
+  self->priv = G_TYPE_INSTANCE_GET_PRIVATE (self,
+      MAYNARD_ACTIVITY_TYPE,
+      MaynardActivityPrivate);
+
+  self->priv->active = TRUE;
+  self->priv->idles = g_hash_table_new_full (NULL, NULL,
+      NULL, activity_idle_free);
+  self->priv->next_idle_id = 1;
+}
+
+static void
+maynard_activity_finalize (GObject *object)
+{
+  MaynardActivity *self = MAYNARD_ACTIVITY (object);
+
+  g_hash_table_destroy (self->priv->idles);
+
+  G_OBJECT_CLASS (maynard_activity_parent_class)->finalize (object);
+}
+
+static void
+maynard_activity_get_property (GObject *object,
+    guint param_id,
+    GValue *value,
+    GParamSpec *pspec)
+{
+  MaynardActivity *self = MAYNARD_ACTIVITY (object);
+
+  switch (param_id)
+    {
+      case PROP_ACTIVE:
+        g_value_set_boolean (value, self->priv->active);
+        break;
+      default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID (object, param_id, pspec);
+        break;
+    }
+}
+
+static void
+maynard_activity_class_init (MaynardActivityClass *klass)
+{
+  GObjectClass *object_class = (GObjectClass *)klass;
+
+  object_class->finalize = maynard_activity_finalize;
+  object_class->get_property = maynard_activity_get_property;
+
+  g_object_class_install_property (object_class, PROP_ACTIVE,
+      g_param_spec_boolean ("active",
+          "active",
+          "Whether the output is on and the session is in use",
+          TRUE,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  g_type_class_add_private (object_class, sizeof (MaynardActivityPrivate));
+}
+
+/**
+ * maynard_activity_get_default:
+ *
+ * Return Value: (transfer none): The global #MaynardActivity singleton
+ */
+MaynardActivity *
+maynard_activity_get_default (void)
+{
+  static MaynardActivity *instance = NULL;
+
+  if (instance == NULL)
+    instance = g_object_new (MAYNARD_ACTIVITY_TYPE, NULL);
+
+  return instance;
+}
+
+gboolean
+maynard_activity_is_active (MaynardActivity *self)
+{
+  return self->priv->active;
+}
+
+static gboolean
+activity_idle_dispatch_cb (gpointer data)
+{
+  ActivityIdle *idle = data;
+
+  if (idle->function (idle->data))
+    return G_SOURCE_CONTINUE;
+
+  /* the source is going away on its own, don't remove it twice */
+  idle->source_id = 0;
+  g_hash_table_remove (idle->activity->priv->idles,
+      GUINT_TO_POINTER (idle->id));
+
+  return G_SOURCE_REMOVE;
+}
+
+void
+maynard_activity_set_active (MaynardActivity *self,
+    gboolean active)
+{
+  GHashTableIter iter;
+  gpointer value;
+
+  active = !!active;
+
+  if (self->priv->active == active)
+    return;
+
+  self->priv->active = active;
+
+  g_hash_table_iter_init (&iter, self->priv->idles);
+  while (g_hash_table_iter_next (&iter, NULL, &value))
+    {
+      ActivityIdle *idle = value;
+
+      if (active && idle->source_id == 0)
+        {
+          idle->source_id = g_idle_add (activity_idle_dispatch_cb, idle);
+        }
+      else if (!active && idle->source_id > 0)
+        {
+          g_source_remove (idle->source_id);
+          idle->source_id = 0;
+          self->priv->deferred_idles++;
+        }
+    }
+
+  if (active)
+    g_debug ("output active again; %u idle callbacks deferred and "
+        "%u wakeups avoided so far", self->priv->deferred_idles,
+        self->priv->avoided_wakeups);
+
+  g_object_notify (G_OBJECT (self), "active");
+}
+
+/* like g_idle_add() but the callback is held back while the output
+ * is idle. the returned id is only valid for
+ * maynard_activity_idle_remove(). */
+guint
+maynard_activity_idle_add (MaynardActivity *self,
+    GSourceFunc function,
+    gpointer data)
+{
+  ActivityIdle *idle;
+
+  idle = g_slice_new0 (ActivityIdle);
+  idle->activity = self;
+  idle->id = self->priv->next_idle_id++;
+  idle->function = function;
+  idle->data = data;
+
+  if (self->priv->active)
+    idle->source_id = g_idle_add (activity_idle_dispatch_cb, idle);
+  else
+    self->priv->deferred_idles++;
+
+  g_hash_table_insert (self->priv->idles, GUINT_TO_POINTER (idle->id), idle);
+
+  return idle->id;
+}
+
+void
+maynard_activity_idle_remove (MaynardActivity *self,
+    guint id)
+{
+  g_hash_table_remove (self->priv->idles, GUINT_TO_POINTER (id));
+}
+
+void
+maynard_activity_add_avoided_wakeups (MaynardActivity *self,
+    guint count)
+{
+  self->priv->avoided_wakeups += count;
+}
+
+guint
+maynard_activity_get_avoided_wakeups (MaynardActivity *self)
+{
+  return self->priv->avoided_wakeups;
+}
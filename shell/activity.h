@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2014 Collabora Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#ifndef __MAYNARD_ACTIVITY_H__
+#define __MAYNARD_ACTIVITY_H__
+
+#include <glib-object.h>
+
+#define MAYNARD_ACTIVITY_TYPE                 (maynard_activity_get_type ())
+#define MAYNARD_ACTIVITY(obj)                 (G_TYPE_CHECK_INSTANCE_CAST ((obj), MAYNARD_ACTIVITY_TYPE, MaynardActivity))
+#define MAYNARD_ACTIVITY_CLASS(klass)         (G_TYPE_CHECK_CLASS_CAST ((klass), MAYNARD_ACTIVITY_TYPE, MaynardActivityClass))
+#define MAYNARD_IS_ACTIVITY(obj)              (G_TYPE_CHECK_INSTANCE_TYPE ((obj), MAYNARD_ACTIVITY_TYPE))
+#define MAYNARD_IS_ACTIVITY_CLASS(klass)      (G_TYPE_CHECK_CLASS_TYPE ((klass), MAYNARD_ACTIVITY_TYPE))
+#define MAYNARD_ACTIVITY_GET_CLASS(obj)       (G_TYPE_INSTANCE_GET_CLASS ((obj), MAYNARD_ACTIVITY_TYPE, MaynardActivityClass))
+
+typedef struct MaynardActivity MaynardActivity;
+typedef struct MaynardActivityClass MaynardActivityClass;
+typedef struct MaynardActivityPrivate MaynardActivityPrivate;
+
+struct MaynardActivity
+{
+  GObject parent;
+
+  MaynardActivityPrivate *priv;
+};
+
+struct MaynardActivityClass
+{
+  GObjectClass parent_class;
+};
+
+GType maynard_activity_get_type (void) G_GNUC_CONST;
+
+MaynardActivity * maynard_activity_get_default (void);
+
+gboolean maynard_activity_is_active (MaynardActivity *self);
+void maynard_activity_set_active (MaynardActivity *self, gboolean active);
+
+guint maynard_activity_idle_add (MaynardActivity *self,
+    GSourceFunc function, gpointer data);
+void maynard_activity_idle_remove (MaynardActivity *self, guint id);
+
+void maynard_activity_add_avoided_wakeups (MaynardActivity *self,
+    guint count);
+guint maynard_activity_get_avoided_wakeups (MaynardActivity *self);
+
+#endif /* __MAYNARD_ACTIVITY_H__ */
@@ -23,6 +23,8 @@
 
 #include "app-icon.h"
 
+#include "icon-cache.h"
+
 G_DEFINE_TYPE(MaynardAppIcon, maynard_app_icon, GTK_TYPE_BUTTON)
 
 static void
@@ -66,7 +68,7 @@ maynard_app_icon_new_from_gicon (GIcon *icon)
 {
   GtkWidget *widget, *image;
 
-  image = gtk_image_new_from_gicon (icon, GTK_ICON_SIZE_DIALOG);
+  image = maynard_icon_cache_new_image (icon, GTK_ICON_SIZE_DIALOG);
 
   widget = g_object_new (MAYNARD_APP_ICON_TYPE,
       "image", image,
@@ -21,12 +21,15 @@
 
 #include "config.h"
 
-#include <alsa/asoundlib.h>
 #define GNOME_DESKTOP_USE_UNSTABLE_API
 #include <libgnome-desktop/gnome-wall-clock.h>
 
 #include "clock.h"
 
+#include "activity.h"
+#include "mixer.h"
+#include "trace.h"
+
 enum {
   VOLUME_CHANGED,
   N_SIGNALS
@@ -42,12 +45,19 @@ struct MaynardClockPrivate {
 
   GtkWidget *volume_scale;
   GtkWidget *volume_image;
+  const gchar *volume_icon_name;
+
+  /* slider changes are written to the mixer at most once a frame */
+  guint volume_tick_id;
+  gboolean volume_pending;
+  gdouble pending_volume;
+  gboolean volume_grabbed;
 
   GnomeWallClock *wall_clock;
+  gint64 wall_clock_stopped_time;
 
-  snd_mixer_t *mixer_handle;
-  snd_mixer_elem_t *mixer;
-  glong min_volume, max_volume;
+  MaynardMixer *mixer;
+  gboolean updating_from_mixer;
 };
 
 G_DEFINE_TYPE(MaynardClock, maynard_clock, GTK_TYPE_WINDOW)
@@ -60,30 +70,58 @@ maynard_clock_init (MaynardClock *self)
       MaynardClockPrivate);
 }
 
-static gdouble
-alsa_volume_to_percentage (MaynardClock *self,
-    glong value)
+static void
+volume_flush (MaynardClock *self)
 {
-  glong range;
+  if (self->priv->volume_tick_id > 0)
+    {
+      gtk_widget_remove_tick_callback (self->priv->volume_scale,
+          self->priv->volume_tick_id);
+      self->priv->volume_tick_id = 0;
+    }
 
-  /* min volume isn't always zero unfortunately */
-  range = self->priv->max_volume - self->priv->min_volume;
+  if (!self->priv->volume_pending)
+    return;
 
-  value -= self->priv->min_volume;
+  self->priv->volume_pending = FALSE;
 
-  return (value / (gdouble) range) * 100;
+  maynard_mixer_set_volume (self->priv->mixer, self->priv->pending_volume);
 }
 
-static glong
-percentage_to_alsa_volume (MaynardClock *self,
-    gdouble value)
+static gboolean
+volume_tick_cb (GtkWidget *widget,
+    GdkFrameClock *frame_clock,
+    gpointer data)
 {
-  glong range;
+  MaynardClock *self = MAYNARD_CLOCK (data);
+
+  /* returning G_SOURCE_REMOVE removes the tick callback for us */
+  self->priv->volume_tick_id = 0;
+  volume_flush (self);
+
+  return G_SOURCE_REMOVE;
+}
+
+static gboolean
+volume_button_press_cb (GtkWidget *widget,
+    GdkEventButton *event,
+    MaynardClock *self)
+{
+  self->priv->volume_grabbed = TRUE;
+
+  return FALSE;
+}
 
-  /* min volume isn't always zero unfortunately */
-  range = self->priv->max_volume - self->priv->min_volume;
+static gboolean
+volume_button_release_cb (GtkWidget *widget,
+    GdkEventButton *event,
+    MaynardClock *self)
+{
+  /* always apply the final value straight away */
+  self->priv->volume_grabbed = FALSE;
+  volume_flush (self);
 
-  return (range * value / 100) + self->priv->min_volume;
+  return FALSE;
 }
 
 static void
@@ -92,14 +130,17 @@ volume_changed_cb (GtkRange *range,
 {
   gdouble value;
   const gchar *icon_name;
-  GtkWidget *box;
 
   value = gtk_range_get_value (range);
 
-  if (self->priv->mixer != NULL)
+  if (!self->priv->updating_from_mixer)
     {
-      snd_mixer_selem_set_playback_volume_all (self->priv->mixer,
-          percentage_to_alsa_volume (self, value));
+      self->priv->pending_volume = value;
+      self->priv->volume_pending = TRUE;
+
+      if (self->priv->volume_tick_id == 0)
+        self->priv->volume_tick_id = gtk_widget_add_tick_callback (
+            self->priv->volume_scale, volume_tick_cb, self, NULL);
     }
 
   /* update the icon */
@@ -112,33 +153,30 @@ volume_changed_cb (GtkRange *range,
   else
     icon_name = "audio-volume-muted-symbolic";
 
-  box = gtk_widget_get_parent (self->priv->volume_image);
-  gtk_widget_destroy (self->priv->volume_image);
-  self->priv->volume_image = gtk_image_new_from_icon_name (
-      icon_name, GTK_ICON_SIZE_LARGE_TOOLBAR);
-  gtk_box_pack_start (GTK_BOX (box), self->priv->volume_image,
-      FALSE, FALSE, 0);
-  gtk_widget_show (self->priv->volume_image);
+  if (g_strcmp0 (icon_name, self->priv->volume_icon_name) != 0)
+    {
+      self->priv->volume_icon_name = icon_name;
+      gtk_image_set_from_icon_name (GTK_IMAGE (self->priv->volume_image),
+          icon_name, GTK_ICON_SIZE_LARGE_TOOLBAR);
+    }
 
   g_signal_emit (self, signals[VOLUME_CHANGED], 0, value, icon_name);
 }
 
-static gboolean
-volume_idle_cb (gpointer data)
+static void
+mixer_volume_changed_cb (MaynardMixer *mixer,
+    gdouble volume,
+    MaynardClock *self)
 {
-  MaynardClock *self = MAYNARD_CLOCK (data);
-  glong volume;
-
-  if (self->priv->mixer != NULL)
-    {
-      snd_mixer_selem_get_playback_volume (self->priv->mixer,
-          SND_MIXER_SCHN_MONO, &volume);
-
-      gtk_range_set_value (GTK_RANGE (self->priv->volume_scale),
-          alsa_volume_to_percentage (self, volume));
-    }
-
-  return G_SOURCE_REMOVE;
+  /* don't fight the user while they are dragging the slider or we
+   * still have a value of our own to write */
+  if (self->priv->volume_grabbed || self->priv->volume_pending)
+    return;
+
+  /* the value is already in the mixer, don't write it back */
+  self->priv->updating_from_mixer = TRUE;
+  gtk_range_set_value (GTK_RANGE (self->priv->volume_scale), volume);
+  self->priv->updating_from_mixer = FALSE;
 }
 
 static GtkWidget *
@@ -154,8 +192,9 @@ create_volume_box (MaynardClock *self)
 
   box = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 0);
 
+  self->priv->volume_icon_name = "audio-volume-muted-symbolic";
   self->priv->volume_image = gtk_image_new_from_icon_name (
-      "audio-volume-muted-symbolic",
+      self->priv->volume_icon_name,
       GTK_ICON_SIZE_LARGE_TOOLBAR);
   gtk_box_pack_start (GTK_BOX (box), self->priv->volume_image,
       FALSE, FALSE, 0);
@@ -168,11 +207,10 @@ create_volume_box (MaynardClock *self)
 
   g_signal_connect (self->priv->volume_scale, "value-changed",
       G_CALLBACK (volume_changed_cb), self);
-
-  /* set the initial value in an idle so ::volume-changed is emitted
-   * when other widgets are connected to the signal and can react
-   * accordingly. */
-  g_idle_add (volume_idle_cb, self);
+  g_signal_connect (self->priv->volume_scale, "button-press-event",
+      G_CALLBACK (volume_button_press_cb), self);
+  g_signal_connect (self->priv->volume_scale, "button-release-event",
+      G_CALLBACK (volume_button_release_cb), self);
 
   return box;
 }
@@ -197,65 +235,65 @@ wall_clock_notify_cb (GnomeWallClock *wall_clock,
 }
 
 static void
-setup_mixer (MaynardClock *self)
+wall_clock_start (MaynardClock *self)
 {
-  snd_mixer_selem_id_t *sid;
-  gint ret;
-
-  /* this is all pretty specific to the rpi */
-
-  if ((ret = snd_mixer_open (&self->priv->mixer_handle, 0)) < 0)
-    goto error;
-
-  if ((ret = snd_mixer_attach (self->priv->mixer_handle, "default")) < 0)
-    goto error;
-
-  if ((ret = snd_mixer_selem_register (self->priv->mixer_handle, NULL, NULL)) < 0)
-    goto error;
-
-  if ((ret = snd_mixer_load (self->priv->mixer_handle)) < 0)
-    goto error;
-
-  snd_mixer_selem_id_alloca (&sid);
-  snd_mixer_selem_id_set_index (sid, 0);
-  snd_mixer_selem_id_set_name (sid, "PCM");
-  self->priv->mixer = snd_mixer_find_selem (self->priv->mixer_handle, sid);
+  self->priv->wall_clock = g_object_new (GNOME_TYPE_WALL_CLOCK, NULL);
+  g_signal_connect (self->priv->wall_clock, "notify::clock",
+      G_CALLBACK (wall_clock_notify_cb), self);
+}
 
-  /* fallback to mixer "Master" */
-  if (self->priv->mixer == NULL)
+static void
+activity_notify_cb (MaynardActivity *activity,
+    GParamSpec *pspec,
+    MaynardClock *self)
+{
+  if (!maynard_activity_is_active (activity))
     {
-      snd_mixer_selem_id_set_name (sid, "Master");
-      self->priv->mixer = snd_mixer_find_selem (self->priv->mixer_handle, sid);
-      if (self->priv->mixer == NULL)
-        goto error;
+      /* dropping the wall clock removes its timeout, so nothing wakes
+       * us up every minute while the screen is blanked. */
+      g_clear_object (&self->priv->wall_clock);
+      self->priv->wall_clock_stopped_time = g_get_monotonic_time ();
+      return;
     }
 
-  if ((ret = snd_mixer_selem_get_playback_volume_range (self->priv->mixer,
-              &self->priv->min_volume, &self->priv->max_volume)) < 0)
-    goto error;
+  if (self->priv->wall_clock != NULL)
+    return;
+
+  maynard_activity_add_avoided_wakeups (activity,
+      (g_get_monotonic_time () - self->priv->wall_clock_stopped_time)
+      / (60 * G_USEC_PER_SEC));
+
+  wall_clock_start (self);
+  wall_clock_notify_cb (self->priv->wall_clock, NULL, self);
+}
 
-  return;
+static void
+setup_mixer (MaynardClock *self)
+{
+  gint64 begin = maynard_trace_begin ();
 
-error:
-  g_debug ("failed to setup mixer: %s", snd_strerror (ret));
+  /* the initial value arrives from the mixer thread through the main
+   * loop, so ::volume-changed is emitted once other widgets are
+   * connected to the signal and can react accordingly. */
+  self->priv->mixer = maynard_mixer_new ();
+  g_signal_connect (self->priv->mixer, "volume-changed",
+      G_CALLBACK (mixer_volume_changed_cb), self);
 
-  if (self->priv->mixer_handle != NULL)
-    snd_mixer_close (self->priv->mixer_handle);
-  self->priv->mixer_handle = NULL;
-  self->priv->mixer = NULL;
+  maynard_trace_end (begin, "setup_mixer");
 }
 
 static void
 maynard_clock_constructed (GObject *object)
 {
   MaynardClock *self = MAYNARD_CLOCK (object);
+  MaynardActivity *activity = maynard_activity_get_default ();
   GtkWidget *box, *system_box, *volume_box;
 
   G_OBJECT_CLASS (maynard_clock_parent_class)->constructed (object);
 
-  self->priv->wall_clock = g_object_new (GNOME_TYPE_WALL_CLOCK, NULL);
-  g_signal_connect (self->priv->wall_clock, "notify::clock",
-      G_CALLBACK (wall_clock_notify_cb), self);
+  wall_clock_start (self);
+  g_signal_connect (activity, "notify::active",
+      G_CALLBACK (activity_notify_cb), self);
 
   gtk_window_set_title (GTK_WINDOW (self), "maynard");
   gtk_window_set_decorated (GTK_WINDOW (self), FALSE);
@@ -326,12 +364,18 @@ maynard_clock_dispose (GObject *object)
 {
   MaynardClock *self = MAYNARD_CLOCK (object);
 
+  g_signal_handlers_disconnect_by_func (maynard_activity_get_default (),
+      activity_notify_cb, self);
   g_clear_object (&self->priv->wall_clock);
 
-  if (self->priv->mixer_handle != NULL)
-    snd_mixer_close (self->priv->mixer_handle);
-  self->priv->mixer_handle = NULL;
-  self->priv->mixer = NULL;
+  if (self->priv->volume_scale != NULL)
+    volume_flush (self);
+  self->priv->volume_scale = NULL;
+
+  if (self->priv->mixer != NULL)
+    g_signal_handlers_disconnect_by_func (self->priv->mixer,
+        mixer_volume_changed_cb, self);
+  g_clear_object (&self->priv->mixer);
 
   G_OBJECT_CLASS (maynard_clock_parent_class)->dispose (object);
 }
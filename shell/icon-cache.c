@@ -0,0 +1,170 @@
+/*
+ * Copyright (C) 2014 Collabora Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#include "config.h"
+
+#include "icon-cache.h"
+
+/* every output has its own launcher grid and favorites, showing the
+ * same icons. they are rendered once per size and scale and the
+ * surfaces shared between all the images showing them. */
+
+typedef struct {
+  GIcon *icon;
+  GtkIconSize size;
+} ImageData;
+
+/* "icon size scale" -> cairo_surface_t */
+static GHashTable *cache = NULL;
+
+static void
+theme_changed_cb (GtkIconTheme *theme,
+    gpointer data)
+{
+  g_hash_table_remove_all (cache);
+}
+
+static cairo_surface_t *
+lookup (GIcon *icon,
+    gint size,
+    gint scale)
+{
+  GtkIconTheme *theme = gtk_icon_theme_get_default ();
+  GtkIconInfo *info;
+  cairo_surface_t *surface;
+  gchar *name, *key;
+  GError *error = NULL;
+
+  if (cache == NULL)
+    {
+      cache = g_hash_table_new_full (g_str_hash, g_str_equal,
+          g_free, (GDestroyNotify) cairo_surface_destroy);
+      g_signal_connect (theme, "changed",
+          G_CALLBACK (theme_changed_cb), NULL);
+    }
+
+  name = g_icon_to_string (icon);
+  key = g_strdup_printf ("%s %d %d", name, size, scale);
+  g_free (name);
+
+  surface = g_hash_table_lookup (cache, key);
+  if (surface != NULL)
+    {
+      g_free (key);
+      return surface;
+    }
+
+  info = gtk_icon_theme_lookup_by_gicon_for_scale (theme, icon,
+      size, scale, GTK_ICON_LOOKUP_FORCE_SIZE);
+  if (info == NULL)
+    {
+      g_free (key);
+      return NULL;
+    }
+
+  /* sets the device scale, so the image is drawn at its logical size */
+  surface = gtk_icon_info_load_surface (info, NULL, &error);
+  g_object_unref (info);
+
+  if (surface == NULL)
+    {
+      g_debug ("could not load icon %s: %s", key, error->message);
+      g_clear_error (&error);
+      g_free (key);
+      return NULL;
+    }
+
+  g_hash_table_insert (cache, key, surface);
+
+  return surface;
+}
+
+static void
+image_update (GtkImage *image)
+{
+  ImageData *data = g_object_get_data (G_OBJECT (image), "maynard-icon");
+  cairo_surface_t *surface;
+  gint size;
+
+  if (!gtk_icon_size_lookup (data->size, &size, NULL))
+    size = 48;
+
+  surface = lookup (data->icon, size,
+      gtk_widget_get_scale_factor (GTK_WIDGET (image)));
+
+  if (surface != NULL)
+    gtk_image_set_from_surface (image, surface);
+  else
+    gtk_image_set_from_icon_name (image, "image-missing", data->size);
+}
+
+static void
+image_scale_factor_cb (GtkWidget *image,
+    GParamSpec *pspec,
+    gpointer user_data)
+{
+  image_update (GTK_IMAGE (image));
+}
+
+static void
+image_theme_changed_cb (GtkIconTheme *theme,
+    GtkImage *image)
+{
+  image_update (image);
+}
+
+static void
+image_data_free (gpointer user_data)
+{
+  ImageData *data = user_data;
+
+  g_object_unref (data->icon);
+  g_slice_free (ImageData, data);
+}
+
+/* like gtk_image_new_from_gicon() but drawn from the shared cache,
+ * at the scale of whichever output the image ends up on */
+GtkWidget *
+maynard_icon_cache_new_image (GIcon *icon,
+    GtkIconSize size)
+{
+  GtkWidget *image;
+  ImageData *data;
+
+  if (icon == NULL)
+    return gtk_image_new_from_icon_name ("image-missing", size);
+
+  image = gtk_image_new ();
+
+  data = g_slice_new0 (ImageData);
+  data->icon = g_object_ref (icon);
+  data->size = size;
+  g_object_set_data_full (G_OBJECT (image), "maynard-icon",
+      data, image_data_free);
+
+  /* the cache is cleared first, as it connected before us */
+  image_update (GTK_IMAGE (image));
+
+  g_signal_connect (image, "notify::scale-factor",
+      G_CALLBACK (image_scale_factor_cb), NULL);
+  g_signal_connect_object (gtk_icon_theme_get_default (), "changed",
+      G_CALLBACK (image_theme_changed_cb), image, 0);
+
+  return image;
+}
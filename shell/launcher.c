@@ -22,19 +22,25 @@
 
 #include "config.h"
 
+#include <string.h>
+
 #include "launcher.h"
 
-#include "clock.h"
-#include "panel.h"
+#include "activity.h"
+#include "icon-cache.h"
+#include "layout.h"
 #include "shell-app-system.h"
+#include "trace.h"
 
 enum {
   PROP_0,
   PROP_BACKGROUND,
+  PROP_EDGE,
 };
 
 enum {
   APP_LAUNCHED,
+  DISMISS,
   N_SIGNALS
 };
 static guint signals[N_SIGNALS] = { 0 };
@@ -42,9 +48,20 @@ static guint signals[N_SIGNALS] = { 0 };
 struct MaynardLauncherPrivate {
   /* background widget so we know the output size */
   GtkWidget *background;
+  MaynardLayoutEdge edge;
   ShellAppSystem *app_system;
+  GtkWidget *search_entry;
   GtkWidget *scrolled_window;
   GtkWidget *grid;
+
+  gchar *search; /* casefolded, or NULL to show every app */
+  GtkWidget *first_button; /* what enter in the search entry launches */
+
+  /* the apps still to be added to the grid, a few at a time, and
+   * where the next one goes */
+  GList *pending;
+  guint fill_idle_id;
+  guint left, top, cols;
 };
 
 G_DEFINE_TYPE(MaynardLauncher, maynard_launcher, GTK_TYPE_WINDOW)
@@ -53,6 +70,10 @@ G_DEFINE_TYPE(MaynardLauncher, maynard_launcher, GTK_TYPE_WINDOW)
 #define GRID_ITEM_WIDTH 114
 #define GRID_ITEM_HEIGHT 114
 
+/* how many apps, with their icons, are added to the grid at once;
+ * about a screenful, so the first one is all that is seen */
+#define GRID_FILL_SLICE 12
+
 static void
 maynard_launcher_init (MaynardLauncher *self)
 {
@@ -130,7 +151,8 @@ clicked_cb (GtkWidget *widget,
   g_signal_emit (self, signals[APP_LAUNCHED], 0);
 
   /* do this in an idle so it's not done so obviously onscreen */
-  g_idle_add (app_launched_idle_cb, self);
+  maynard_activity_idle_add (maynard_activity_get_default (),
+      app_launched_idle_cb, self);
 }
 
 static gboolean
@@ -201,7 +223,7 @@ app_launcher_new_from_desktop_info (MaynardLauncher *self,
   gtk_container_add (GTK_CONTAINER (overlay), alignment);
 
   icon = g_app_info_get_icon (G_APP_INFO (info));
-  image = gtk_image_new_from_gicon (icon, GTK_ICON_SIZE_DIALOG);
+  image = maynard_icon_cache_new_image (icon, GTK_ICON_SIZE_DIALOG);
   button = gtk_button_new ();
   gtk_style_context_remove_class (
       gtk_widget_get_style_context (button),
@@ -224,48 +246,128 @@ app_launcher_new_from_desktop_info (MaynardLauncher *self,
   g_signal_connect (ebox, "enter-notify-event", G_CALLBACK (app_enter_cb), revealer);
   g_signal_connect (ebox, "leave-notify-event", G_CALLBACK (app_leave_cb), revealer);
 
+  /* the same for moving through the grid with the arrow keys */
+  g_signal_connect (button, "focus-in-event", G_CALLBACK (app_enter_cb), revealer);
+  g_signal_connect (button, "focus-out-event", G_CALLBACK (app_leave_cb), revealer);
+
+  if (self->priv->first_button == NULL)
+    self->priv->first_button = button;
+
   return ebox;
 }
 
+static gboolean
+app_matches (MaynardLauncher *self,
+    GAppInfo *info)
+{
+  gchar *name;
+  gboolean ret;
+
+  if (self->priv->search == NULL)
+    return TRUE;
+
+  name = g_utf8_casefold (g_app_info_get_display_name (info), -1);
+  ret = strstr (name, self->priv->search) != NULL;
+  g_free (name);
+
+  return ret;
+}
+
+static void
+fill_cancel (MaynardLauncher *self)
+{
+  if (self->priv->fill_idle_id > 0)
+    {
+      g_source_remove (self->priv->fill_idle_id);
+      self->priv->fill_idle_id = 0;
+    }
+
+  g_list_free_full (self->priv->pending, g_object_unref);
+  self->priv->pending = NULL;
+}
+
+/* adds the next few apps. creating the buttons and their icons is
+ * what takes the time, so it is done a slice at a time and the shell
+ * keeps drawing in between. */
+static gboolean
+fill_slice (MaynardLauncher *self)
+{
+  MaynardLauncherPrivate *priv = self->priv;
+  guint added = 0;
+
+  while (priv->pending != NULL && added < GRID_FILL_SLICE)
+    {
+      GDesktopAppInfo *info = priv->pending->data;
+      GtkWidget *app;
+
+      priv->pending = g_list_delete_link (priv->pending, priv->pending);
+
+      if (app_matches (self, G_APP_INFO (info)))
+        {
+          app = app_launcher_new_from_desktop_info (self, info);
+          gtk_grid_attach (GTK_GRID (priv->grid), app,
+              priv->left++, priv->top, 1, 1);
+          gtk_widget_show_all (app);
+
+          if (priv->left > priv->cols)
+            {
+              priv->left = 0;
+              priv->top++;
+            }
+
+          added++;
+        }
+
+      /* the button keeps its own reference */
+      g_object_unref (info);
+    }
+
+  return priv->pending != NULL;
+}
+
+static gboolean
+fill_idle_cb (gpointer data)
+{
+  MaynardLauncher *self = data;
+
+  if (fill_slice (self))
+    return G_SOURCE_CONTINUE;
+
+  self->priv->fill_idle_id = 0;
+  return G_SOURCE_REMOVE;
+}
+
 static void
 installed_changed_cb (ShellAppSystem *app_system,
     MaynardLauncher *self)
 {
   GHashTable *entries = shell_app_system_get_entries (app_system);
-  GList *l, *values;
+  GList *values;
+  gint cols;
 
-  gint output_width, output_height;
-  guint cols;
-  guint left, top;
+  fill_cancel (self);
 
   /* remove all children first */
   gtk_container_foreach (GTK_CONTAINER (self->priv->grid),
       (GtkCallback) gtk_widget_destroy, NULL);
+  self->priv->first_button = NULL;
 
   values = g_hash_table_get_values (entries);
-  values = g_list_sort (values, sort_apps);
+  g_list_foreach (values, (GFunc) g_object_ref, NULL);
+  self->priv->pending = g_list_sort (values, sort_apps);
 
   maynard_launcher_calculate (self, NULL, NULL, &cols);
-  cols--; /* because we start from zero here */
-
-  left = top = 0;
-  for (l = values; l; l = l->next)
-    {
-      GDesktopAppInfo *info = G_DESKTOP_APP_INFO (l->data);
-      GtkWidget *app = app_launcher_new_from_desktop_info (self, info);
+  self->priv->cols = cols - 1; /* because we start from zero here */
+  self->priv->left = self->priv->top = 0;
 
-      gtk_grid_attach (GTK_GRID (self->priv->grid), app, left++, top, 1, 1);
+  gtk_widget_show (self->priv->grid);
 
-      if (left > cols)
-        {
-          left = 0;
-          top++;
-        }
-    }
-
-  g_list_free (values);
-
-  gtk_widget_show_all (self->priv->grid);
+  /* the first apps right away, so there is something to see and
+   * enter has something to launch; the rest when nothing else is
+   * going on */
+  if (fill_slice (self))
+    self->priv->fill_idle_id = g_idle_add_full (G_PRIORITY_LOW,
+        fill_idle_cb, self, NULL);
 }
 
 static void
@@ -276,10 +378,63 @@ background_size_allocate_cb (GtkWidget *widget,
   installed_changed_cb (self->priv->app_system, self);
 }
 
+static void
+search_changed_cb (GtkEditable *editable,
+    MaynardLauncher *self)
+{
+  const gchar *text = gtk_entry_get_text (GTK_ENTRY (editable));
+
+  g_free (self->priv->search);
+  self->priv->search = NULL;
+  if (text[0] != '\0')
+    self->priv->search = g_utf8_casefold (text, -1);
+
+  installed_changed_cb (self->priv->app_system, self);
+  app_launched_idle_cb (self);
+}
+
+static void
+search_activate_cb (GtkEntry *entry,
+    MaynardLauncher *self)
+{
+  if (self->priv->first_button != NULL)
+    gtk_button_clicked (GTK_BUTTON (self->priv->first_button));
+}
+
+static gboolean
+maynard_launcher_key_press_event (GtkWidget *widget,
+    GdkEventKey *event)
+{
+  MaynardLauncher *self = MAYNARD_LAUNCHER (widget);
+  GtkWidget *entry = self->priv->search_entry;
+  gunichar c;
+
+  if (event->keyval == GDK_KEY_Escape)
+    {
+      g_signal_emit (self, signals[DISMISS], 0);
+      return TRUE;
+    }
+
+  /* typing anywhere in the grid searches */
+  c = gdk_keyval_to_unicode (event->keyval);
+  if (!gtk_widget_has_focus (entry) && c != 0 && g_unichar_isprint (c)
+      && !(event->state & (GDK_CONTROL_MASK | GDK_MOD1_MASK)))
+    {
+      gtk_widget_grab_focus (entry);
+      gtk_editable_set_position (GTK_EDITABLE (entry), -1);
+      return gtk_widget_event (entry, (GdkEvent *) event);
+    }
+
+  return GTK_WIDGET_CLASS (maynard_launcher_parent_class)->key_press_event (
+      widget, event);
+}
+
 static void
 maynard_launcher_constructed (GObject *object)
 {
   MaynardLauncher *self = MAYNARD_LAUNCHER (object);
+  GtkWidget *box;
+  gint64 begin = maynard_trace_begin ();
 
   G_OBJECT_CLASS (maynard_launcher_parent_class)->constructed (object);
 
@@ -293,15 +448,44 @@ maynard_launcher_constructed (GObject *object)
       gtk_widget_get_style_context (GTK_WIDGET (self)),
       "maynard-grid");
 
+  box = gtk_box_new (GTK_ORIENTATION_VERTICAL, 0);
+  gtk_container_add (GTK_CONTAINER (self), box);
+
+  /* search by name; it has the focus whenever the grid is shown */
+  self->priv->search_entry = gtk_entry_new ();
+  gtk_entry_set_icon_from_icon_name (GTK_ENTRY (self->priv->search_entry),
+      GTK_ENTRY_ICON_PRIMARY, "edit-find-symbolic");
+  gtk_style_context_add_class (
+      gtk_widget_get_style_context (self->priv->search_entry),
+      "maynard-grid-search");
+  g_signal_connect (self->priv->search_entry, "changed",
+      G_CALLBACK (search_changed_cb), self);
+  g_signal_connect (self->priv->search_entry, "activate",
+      G_CALLBACK (search_activate_cb), self);
+  gtk_box_pack_start (GTK_BOX (box), self->priv->search_entry,
+      FALSE, FALSE, 0);
+
   /* scroll it */
   self->priv->scrolled_window = gtk_scrolled_window_new (NULL, NULL);
-  gtk_container_add (GTK_CONTAINER (self), self->priv->scrolled_window);
+  gtk_box_pack_start (GTK_BOX (box), self->priv->scrolled_window,
+      TRUE, TRUE, 0);
+
+  /* a flick keeps it going, and the apps only see taps */
+  gtk_scrolled_window_set_kinetic_scrolling (
+      GTK_SCROLLED_WINDOW (self->priv->scrolled_window), TRUE);
+  gtk_scrolled_window_set_capture_button_press (
+      GTK_SCROLLED_WINDOW (self->priv->scrolled_window), TRUE);
 
   /* main grid for apps */
   self->priv->grid = gtk_grid_new ();
   gtk_container_add (GTK_CONTAINER (self->priv->scrolled_window),
       self->priv->grid);
 
+  /* keep the app with the keyboard focus in view */
+  gtk_container_set_focus_vadjustment (GTK_CONTAINER (self->priv->grid),
+      gtk_scrolled_window_get_vadjustment (
+          GTK_SCROLLED_WINDOW (self->priv->scrolled_window)));
+
   /* fill the grid with apps */
   self->priv->app_system = shell_app_system_get_default ();
   g_signal_connect (self->priv->app_system, "installed-changed",
@@ -314,6 +498,42 @@ maynard_launcher_constructed (GObject *object)
 
   /* now actually fill the grid */
   installed_changed_cb (self->priv->app_system, self);
+
+  maynard_trace_end (begin, "maynard_launcher_constructed");
+}
+
+static void
+maynard_launcher_dispose (GObject *object)
+{
+  MaynardLauncher *self = MAYNARD_LAUNCHER (object);
+
+  fill_cancel (self);
+
+  if (self->priv->app_system != NULL)
+    {
+      g_signal_handlers_disconnect_by_func (self->priv->app_system,
+          installed_changed_cb, self);
+      self->priv->app_system = NULL;
+    }
+
+  if (self->priv->background != NULL)
+    {
+      g_signal_handlers_disconnect_by_func (self->priv->background,
+          background_size_allocate_cb, self);
+      self->priv->background = NULL;
+    }
+
+  G_OBJECT_CLASS (maynard_launcher_parent_class)->dispose (object);
+}
+
+static void
+maynard_launcher_finalize (GObject *object)
+{
+  MaynardLauncher *self = MAYNARD_LAUNCHER (object);
+
+  g_free (self->priv->search);
+
+  G_OBJECT_CLASS (maynard_launcher_parent_class)->finalize (object);
 }
 
 static void
@@ -329,6 +549,9 @@ maynard_launcher_get_property (GObject *object,
       case PROP_BACKGROUND:
         g_value_set_object (value, self->priv->background);
         break;
+      case PROP_EDGE:
+        g_value_set_int (value, self->priv->edge);
+        break;
       default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID (object, param_id, pspec);
         break;
@@ -348,6 +571,9 @@ maynard_launcher_set_property (GObject *object,
       case PROP_BACKGROUND:
         self->priv->background = g_value_get_object (value);
         break;
+      case PROP_EDGE:
+        self->priv->edge = g_value_get_int (value);
+        break;
       default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID (object, param_id, pspec);
         break;
@@ -358,11 +584,16 @@ static void
 maynard_launcher_class_init (MaynardLauncherClass *klass)
 {
   GObjectClass *object_class = (GObjectClass *)klass;
+  GtkWidgetClass *widget_class = (GtkWidgetClass *)klass;
 
   object_class->constructed = maynard_launcher_constructed;
+  object_class->dispose = maynard_launcher_dispose;
+  object_class->finalize = maynard_launcher_finalize;
   object_class->get_property = maynard_launcher_get_property;
   object_class->set_property = maynard_launcher_set_property;
 
+  widget_class->key_press_event = maynard_launcher_key_press_event;
+
   g_object_class_install_property (object_class, PROP_BACKGROUND,
       g_param_spec_object ("background",
           "background",
@@ -370,18 +601,33 @@ maynard_launcher_class_init (MaynardLauncherClass *klass)
           GTK_TYPE_WIDGET,
           G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (object_class, PROP_EDGE,
+      g_param_spec_int ("edge",
+          "edge",
+          "The #MaynardLayoutEdge the panel is on",
+          MAYNARD_LAYOUT_EDGE_LEFT, MAYNARD_LAYOUT_EDGE_BOTTOM,
+          MAYNARD_LAYOUT_EDGE_LEFT,
+          G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY | G_PARAM_STATIC_STRINGS));
+
   signals[APP_LAUNCHED] = g_signal_new ("app-launched",
       G_TYPE_FROM_CLASS (klass), G_SIGNAL_RUN_LAST, 0, NULL, NULL,
       NULL, G_TYPE_NONE, 0);
 
+  /* escape was pressed */
+  signals[DISMISS] = g_signal_new ("dismiss",
+      G_TYPE_FROM_CLASS (klass), G_SIGNAL_RUN_LAST, 0, NULL, NULL,
+      NULL, G_TYPE_NONE, 0);
+
   g_type_class_add_private (object_class, sizeof (MaynardLauncherPrivate));
 }
 
 GtkWidget *
-maynard_launcher_new (GtkWidget *background_widget)
+maynard_launcher_new (GtkWidget *background_widget,
+    MaynardLayoutEdge edge)
 {
   return g_object_new (MAYNARD_LAUNCHER_TYPE,
       "background", background_widget,
+      "edge", edge,
       NULL);
 }
 
@@ -391,19 +637,23 @@ maynard_launcher_calculate (MaynardLauncher *self,
     gint *grid_window_height,
     gint *grid_cols)
 {
-  gint output_width, output_height, panel_height;
+  gint output_width, output_height;
   gint usable_width, usable_height;
   guint cols, rows;
   guint num_apps;
   guint scrollbar_width = 13;
+  gint search_height;
 
   gtk_widget_get_size_request (self->priv->background,
       &output_width, &output_height);
-  panel_height = output_height * MAYNARD_PANEL_HEIGHT_RATIO;
+  gtk_widget_get_preferred_height (self->priv->search_entry,
+      NULL, &search_height);
 
-  usable_width = output_width - MAYNARD_PANEL_WIDTH - scrollbar_width;
-  /* don't go further down than the panel */
-  usable_height = panel_height - MAYNARD_CLOCK_HEIGHT;
+  /* don't go further along the edge than the panel */
+  maynard_layout_get_grid_area (self->priv->edge,
+      output_width, output_height, &usable_width, &usable_height);
+  usable_width -= scrollbar_width;
+  usable_height -= search_height;
 
   /* try and fill half the screen, otherwise round down */
   cols = (int) ((usable_width / 2.0) / GRID_ITEM_WIDTH);
@@ -423,8 +673,36 @@ maynard_launcher_calculate (MaynardLauncher *self,
     *grid_window_width = (cols * GRID_ITEM_WIDTH) + scrollbar_width;
 
   if (grid_window_height)
-    *grid_window_height = (rows * GRID_ITEM_HEIGHT);
+    *grid_window_height = (rows * GRID_ITEM_HEIGHT) + search_height;
 
   if (grid_cols)
     *grid_cols = cols;
 }
+
+/* back to every app, scrolled to the top, ready for typing */
+void
+maynard_launcher_reset (MaynardLauncher *self)
+{
+  gtk_entry_set_text (GTK_ENTRY (self->priv->search_entry), "");
+  app_launched_idle_cb (self);
+  gtk_widget_grab_focus (self->priv->search_entry);
+}
+
+/* whether a finger moving dy pixels down would still scroll the grid,
+ * rather than be at the end already */
+gboolean
+maynard_launcher_can_scroll (MaynardLauncher *self,
+    gdouble dy)
+{
+  GtkAdjustment *adjustment = gtk_scrolled_window_get_vadjustment (
+      GTK_SCROLLED_WINDOW (self->priv->scrolled_window));
+  gdouble value = gtk_adjustment_get_value (adjustment);
+
+  if (dy < 0)
+    return value < gtk_adjustment_get_upper (adjustment)
+        - gtk_adjustment_get_page_size (adjustment);
+  if (dy > 0)
+    return value > gtk_adjustment_get_lower (adjustment);
+
+  return FALSE;
+}
@@ -25,6 +25,8 @@
 
 #include <gtk/gtk.h>
 
+#include "layout.h"
+
 #define MAYNARD_LAUNCHER_TYPE                 (maynard_launcher_get_type ())
 #define MAYNARD_LAUNCHER(obj)                 (G_TYPE_CHECK_INSTANCE_CAST ((obj), MAYNARD_LAUNCHER_TYPE, MaynardLauncher))
 #define MAYNARD_LAUNCHER_CLASS(klass)         (G_TYPE_CHECK_CLASS_CAST ((klass), MAYNARD_LAUNCHER_TYPE, MaynardLauncherClass))
@@ -50,10 +52,16 @@ struct MaynardLauncherClass
 
 GType maynard_launcher_get_type (void) G_GNUC_CONST;
 
-GtkWidget * maynard_launcher_new (GtkWidget *background_widget);
+GtkWidget * maynard_launcher_new (GtkWidget *background_widget,
+    MaynardLayoutEdge edge);
 
 void maynard_launcher_calculate (MaynardLauncher *self,
     gint *grid_window_width, gint *grid_window_height,
     gint *grid_cols);
 
+void maynard_launcher_reset (MaynardLauncher *self);
+
+gboolean maynard_launcher_can_scroll (MaynardLauncher *self,
+    gdouble dy);
+
 #endif /* __MAYNARD_LAUNCHER_H__ */
@@ -0,0 +1,240 @@
+/*
+ * Copyright (C) 2014 Collabora Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#include "config.h"
+
+#include "layout.h"
+
+#include "clock.h"
+#include "panel.h"
+#include "vertical-clock.h"
+
+/* everything is worked out along the edge the panel is on and
+ * across it, away from the edge, and only turned into output
+ * coordinates at the very end. on the left edge "along" is y and
+ * "across" is x, which is how the panel was first laid out. */
+
+static gboolean
+edge_is_vertical (MaynardLayoutEdge edge)
+{
+  return edge == MAYNARD_LAYOUT_EDGE_LEFT
+    || edge == MAYNARD_LAYOUT_EDGE_RIGHT;
+}
+
+/* the size of something on the output, along and across the edge */
+static void
+to_edge_size (MaynardLayoutEdge edge,
+    gint width, gint height,
+    gint *along, gint *across)
+{
+  if (edge_is_vertical (edge))
+    {
+      *along = height;
+      *across = width;
+    }
+  else
+    {
+      *along = width;
+      *across = height;
+    }
+}
+
+static void
+to_output (MaynardLayoutEdge edge,
+    gint output_width, gint output_height,
+    gint along, gint across,
+    gint along_size, gint across_size,
+    MaynardLayoutBox *box)
+{
+  switch (edge)
+    {
+      case MAYNARD_LAYOUT_EDGE_LEFT:
+        box->x = across;
+        box->y = along;
+        break;
+      case MAYNARD_LAYOUT_EDGE_RIGHT:
+        box->x = output_width - across - across_size;
+        box->y = along;
+        break;
+      case MAYNARD_LAYOUT_EDGE_TOP:
+        box->x = along;
+        box->y = across;
+        break;
+      case MAYNARD_LAYOUT_EDGE_BOTTOM:
+        box->x = along;
+        box->y = output_height - across - across_size;
+        break;
+    }
+
+  if (edge_is_vertical (edge))
+    {
+      box->width = across_size;
+      box->height = along_size;
+    }
+  else
+    {
+      box->width = along_size;
+      box->height = across_size;
+    }
+}
+
+/* a slide of distance towards the edge; negative moves away from it */
+static void
+slide_towards_edge (MaynardLayoutEdge edge,
+    gint distance,
+    gint *slide_x, gint *slide_y)
+{
+  *slide_x = *slide_y = 0;
+
+  switch (edge)
+    {
+      case MAYNARD_LAYOUT_EDGE_LEFT:
+        *slide_x = -distance;
+        break;
+      case MAYNARD_LAYOUT_EDGE_RIGHT:
+        *slide_x = distance;
+        break;
+      case MAYNARD_LAYOUT_EDGE_TOP:
+        *slide_y = -distance;
+        break;
+      case MAYNARD_LAYOUT_EDGE_BOTTOM:
+        *slide_y = distance;
+        break;
+    }
+}
+
+MaynardLayoutEdge
+maynard_layout_get_edge (void)
+{
+  GSettings *settings;
+  MaynardLayoutEdge edge;
+
+  settings = g_settings_new ("org.raspberrypi.maynard");
+  edge = g_settings_get_enum (settings, "panel-edge");
+  g_object_unref (settings);
+
+  return edge;
+}
+
+/* the direction the panel runs in */
+GtkOrientation
+maynard_layout_get_orientation (MaynardLayoutEdge edge)
+{
+  return edge_is_vertical (edge)
+    ? GTK_ORIENTATION_VERTICAL : GTK_ORIENTATION_HORIZONTAL;
+}
+
+/* the space the launcher grid may fill: beside the panel, past the
+ * clock, and no further along the edge than the panel goes */
+void
+maynard_layout_get_grid_area (MaynardLayoutEdge edge,
+    gint output_width, gint output_height,
+    gint *width, gint *height)
+{
+  gint output_along, output_across;
+  gint clock_along, clock_across;
+  gint along, across;
+
+  to_edge_size (edge, output_width, output_height,
+      &output_along, &output_across);
+  to_edge_size (edge, MAYNARD_CLOCK_WIDTH, MAYNARD_CLOCK_HEIGHT,
+      &clock_along, &clock_across);
+
+  along = output_along * MAYNARD_PANEL_HEIGHT_RATIO - clock_along;
+  across = output_across - MAYNARD_PANEL_WIDTH;
+
+  if (edge_is_vertical (edge))
+    {
+      *width = across;
+      *height = along;
+    }
+  else
+    {
+      *width = along;
+      *height = across;
+    }
+}
+
+void
+maynard_layout_compute (MaynardLayout *layout,
+    MaynardLayoutEdge edge,
+    gint output_width, gint output_height,
+    gint grid_width, gint grid_height)
+{
+  gint output_along, output_across;
+  gint panel_along, panel_start;
+  gint clock_along, clock_across;
+  gint grid_along, grid_across;
+
+  layout->edge = edge;
+
+  to_edge_size (edge, output_width, output_height,
+      &output_along, &output_across);
+
+  /* TODO: make this length a little nicer */
+  panel_along = output_along * MAYNARD_PANEL_HEIGHT_RATIO;
+  panel_start = (output_along - panel_along) / 2;
+
+  to_output (edge, output_width, output_height,
+      panel_start, 0,
+      panel_along, MAYNARD_PANEL_WIDTH,
+      &layout->panel);
+
+  /* the clock sits just past the panel, at its start */
+  to_edge_size (edge, MAYNARD_CLOCK_WIDTH, MAYNARD_CLOCK_HEIGHT,
+      &clock_along, &clock_across);
+  to_output (edge, output_width, output_height,
+      panel_start, MAYNARD_PANEL_WIDTH,
+      clock_along, clock_across,
+      &layout->clock);
+
+  maynard_layout_get_hide_slide (layout, 0, 0,
+      &layout->panel.slide_x, &layout->panel.slide_y);
+  maynard_layout_get_hide_slide (layout,
+      layout->clock.width, layout->clock.height,
+      &layout->clock.slide_x, &layout->clock.slide_y);
+
+  /* the grid waits beyond the edge, past the clock, and slides out
+   * until it is beside the panel */
+  to_edge_size (edge, grid_width, grid_height,
+      &grid_along, &grid_across);
+  to_output (edge, output_width, output_height,
+      panel_start + clock_along, - grid_across,
+      grid_along, grid_across,
+      &layout->grid);
+  slide_towards_edge (edge, - (grid_across + MAYNARD_PANEL_WIDTH),
+      &layout->grid.slide_x, &layout->grid.slide_y);
+}
+
+/* how far to slide something of this size, sitting just past the
+ * panel, so that only the vertical clock strip of the panel stays
+ * on the output. 0x0 is the panel itself. */
+void
+maynard_layout_get_hide_slide (MaynardLayout *layout,
+    gint width, gint height,
+    gint *slide_x, gint *slide_y)
+{
+  gint along, across;
+
+  to_edge_size (layout->edge, width, height, &along, &across);
+
+  slide_towards_edge (layout->edge,
+      MAYNARD_PANEL_WIDTH - MAYNARD_VERTICAL_CLOCK_WIDTH + across,
+      slide_x, slide_y);
+}
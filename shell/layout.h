@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2014 Collabora Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#ifndef __MAYNARD_LAYOUT_H__
+#define __MAYNARD_LAYOUT_H__
+
+#include <gtk/gtk.h>
+
+/* keep in sync with the PanelEdge enum in the gschema */
+typedef enum {
+  MAYNARD_LAYOUT_EDGE_LEFT,
+  MAYNARD_LAYOUT_EDGE_RIGHT,
+  MAYNARD_LAYOUT_EDGE_TOP,
+  MAYNARD_LAYOUT_EDGE_BOTTOM
+} MaynardLayoutEdge;
+
+/* where a surface goes on the output, and how far it slides: out of
+ * the way for the panel and clock, into view for the grid */
+typedef struct {
+  gint x, y;
+  gint width, height;
+  gint slide_x, slide_y;
+} MaynardLayoutBox;
+
+typedef struct {
+  MaynardLayoutEdge edge;
+
+  MaynardLayoutBox panel;
+  MaynardLayoutBox clock;
+  MaynardLayoutBox grid;
+} MaynardLayout;
+
+MaynardLayoutEdge maynard_layout_get_edge (void);
+
+GtkOrientation maynard_layout_get_orientation (MaynardLayoutEdge edge);
+
+void maynard_layout_get_grid_area (MaynardLayoutEdge edge,
+    gint output_width, gint output_height,
+    gint *width, gint *height);
+
+void maynard_layout_compute (MaynardLayout *layout,
+    MaynardLayoutEdge edge,
+    gint output_width, gint output_height,
+    gint grid_width, gint grid_height);
+
+void maynard_layout_get_hide_slide (MaynardLayout *layout,
+    gint width, gint height,
+    gint *slide_x, gint *slide_y);
+
+#endif /* __MAYNARD_LAYOUT_H__ */
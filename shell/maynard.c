@@ -34,123 +34,534 @@
 
 #include "maynard-resources.h"
 
+#include "activity.h"
 #include "app-icon.h"
 #include "clock.h"
 #include "favorites.h"
 #include "launcher.h"
+#include "layout.h"
 #include "panel.h"
+#include "shell-app-system.h"
+#include "slideshow.h"
+#include "trace.h"
+#include "velocity.h"
 #include "vertical-clock.h"
+#include "wallpaper.h"
 
 extern char **environ; /* defined by libc */
 
 struct element {
   GtkWidget *window;
-  GdkPixbuf *pixbuf;
+  cairo_surface_t *image;
   struct wl_surface *surface;
+  gboolean opaque; /* paints every pixel itself, whatever the theme says */
 };
 
+/* the panel and clock slide in together while the pointer is over
+ * any of our surfaces or the launcher grid is open, and slide out
+ * otherwise. a slide in progress is only finished by the helper's
+ * slide_done event. */
+typedef enum {
+  PANEL_STATE_SHOWN,
+  PANEL_STATE_HIDING,
+  PANEL_STATE_HIDDEN,
+  PANEL_STATE_SHOWING,
+} PanelState;
+
 struct desktop {
   struct wl_display *display;
   struct wl_registry *registry;
+  struct wl_compositor *compositor;
   struct desktop_shell *shell;
   struct weston_desktop_shell *wshell;
-  struct wl_output *output;
   struct shell_helper *helper;
 
   struct wl_seat *seat;
   struct wl_pointer *pointer;
+  struct wl_touch *touch;
 
   GdkDisplay *gdk_display;
 
+  struct wl_surface *grab_surface;
+
+  MaynardLayoutEdge edge;
+
+  struct wl_list outputs;
+  struct wl_list wallpapers;
+
+  gboolean ready; /* desktop_ready was sent */
+  gboolean grids_done; /* the last of the startup work */
+  gboolean started; /* outputs appearing now need their elements at once */
+
+  /* desktop_ready waits for this output to be drawn */
+  struct output *ready_output;
+  guint ready_paints;
+
+  guint batch_depth; /* see helper_batch_begin() */
+  guint32 reveal_time; /* from the helper, for the revealed event next */
+
+  GSettings *settings; /* for the animations */
+};
+
+/* the wallpaper for every output of one size. it is decoded once,
+ * and the same surface is painted on each of them. */
+struct wallpaper {
+  struct desktop *desktop;
+  gint width, height, scale;
+  guint ref_count;
+
+  MaynardSlideshow *slideshow; /* even for a single image */
+  cairo_surface_t *image; /* flattened */
+
+  struct wl_list link;
+};
+
+/* everything the shell shows on one output */
+struct output {
+  struct desktop *desktop;
+  struct wl_output *output;
+  uint32_t name; /* in the registry */
+
+  /* as the compositor reports them, and what we laid out for */
+  gint32 x, y; /* where the output is in the compositor's space */
+  gint32 mode_width, mode_height;
+  gint32 transform;
+  gint32 scale;
+  gint left, top, width, height;
+
   struct element *background;
   struct element *panel;
-  struct element *curtain;
   struct element *launcher_grid;
   struct element *clock;
+  struct element *fade; /* the old wallpaper while crossfading */
+
+  struct wallpaper *wallpaper;
 
-  guint initial_panel_timeout_id;
-  guint hide_panel_idle_id;
+  MaynardLayout layout;
+  gboolean configured;
+
+  PanelState panel_state;
+  gboolean pointer_in_panel;
+  gboolean touch_shown; /* swiped in; stays until dismissed */
+  guint panel_leave_idle_id;
 
   gboolean grid_visible;
   gboolean system_visible;
   gboolean volume_visible;
-  gboolean pointer_out_of_panel;
+  gboolean background_dirty;
+
+  /* a finger on the panel or the grid */
+  GdkEventSequence *swipe_sequence;
+  gdouble swipe_x, swipe_y;
+  MaynardVelocity swipe_velocity;
+
+  struct wl_list link;
 };
 
+/* the alpha of the background colour the theme gives widget, 0 when
+ * it leaves its background alone */
+static gdouble
+widget_background_alpha (GtkWidget *widget)
+{
+  GtkStyleContext *context = gtk_widget_get_style_context (widget);
+  GdkRGBA *color;
+  gdouble alpha;
+
+  gtk_style_context_get (context, gtk_widget_get_state_flags (widget),
+      GTK_STYLE_PROPERTY_BACKGROUND_COLOR, &color,
+      NULL);
+  alpha = color->alpha;
+  gdk_rgba_free (color);
+
+  return alpha;
+}
+
+/* add what can be seen of widget to region, in the coordinates of
+ * toplevel, without going outside clip. a container which draws no
+ * background of its own only shows its children. */
+static void
+add_visible_area (GtkWidget *widget,
+    GtkWidget *toplevel,
+    const cairo_rectangle_int_t *clip,
+    cairo_region_t *region)
+{
+  cairo_rectangle_int_t rect;
+  GList *children, *l;
+
+  if (!gtk_widget_is_drawable (widget))
+    return;
+
+  if (!gtk_widget_translate_coordinates (widget, toplevel, 0, 0,
+          &rect.x, &rect.y))
+    return;
+
+  rect.width = gtk_widget_get_allocated_width (widget);
+  rect.height = gtk_widget_get_allocated_height (widget);
+
+  /* a revealer only shows part of its child */
+  if (!gdk_rectangle_intersect (&rect, clip, &rect))
+    return;
+
+  if (!GTK_IS_CONTAINER (widget) || widget_background_alpha (widget) > 0.0)
+    {
+      cairo_region_union_rectangle (region, &rect);
+      return;
+    }
+
+  children = gtk_container_get_children (GTK_CONTAINER (widget));
+  for (l = children; l != NULL; l = l->next)
+    add_visible_area (l->data, toplevel, &rect, region);
+  g_list_free (children);
+}
+
+/* tell the compositor which parts of an element it can skip drawing
+ * below and which parts take input. the window background comes from
+ * CSS, so it is opaque unless the theme gave it some transparency;
+ * where the theme left it out altogether, only the widgets inside
+ * are there to be clicked. */
+static void
+element_update_regions (struct element *element)
+{
+  GtkWidget *widget = element->window;
+  GdkWindow *gdk_window = gtk_widget_get_window (widget);
+  cairo_rectangle_int_t rect;
+  cairo_region_t *region, *input;
+  gdouble alpha = 1.0;
+
+  if (gdk_window == NULL)
+    return;
+
+  rect.x = 0;
+  rect.y = 0;
+  rect.width = gtk_widget_get_allocated_width (widget);
+  rect.height = gtk_widget_get_allocated_height (widget);
+  region = cairo_region_create_rectangle (&rect);
+
+  if (!element->opaque)
+    alpha = widget_background_alpha (widget);
+
+  gdk_window_set_opaque_region (gdk_window, alpha >= 1.0 ? region : NULL);
+
+  if (alpha > 0.0)
+    {
+      gdk_window_input_shape_combine_region (gdk_window, region, 0, 0);
+    }
+  else
+    {
+      input = cairo_region_create ();
+      add_visible_area (widget, widget, &rect, input);
+      gdk_window_input_shape_combine_region (gdk_window, input, 0, 0);
+      cairo_region_destroy (input);
+    }
+
+  cairo_region_destroy (region);
+}
+
+static void
+element_size_allocate_cb (GtkWidget *widget,
+    GdkRectangle *allocation,
+    struct element *element)
+{
+  element_update_regions (element);
+}
+
+static void
+element_style_updated_cb (GtkWidget *widget,
+    struct element *element)
+{
+  element_update_regions (element);
+}
+
+static void
+element_track_regions (struct element *element)
+{
+  g_signal_connect_after (element->window, "size-allocate",
+      G_CALLBACK (element_size_allocate_cb), element);
+  g_signal_connect_after (element->window, "style-updated",
+      G_CALLBACK (element_style_updated_cb), element);
+
+  element_update_regions (element);
+}
+
 static gboolean panel_window_enter_cb (GtkWidget *widget,
-    GdkEventCrossing *event, struct desktop *desktop);
+    GdkEventCrossing *event, struct output *output);
 static gboolean panel_window_leave_cb (GtkWidget *widget,
-    GdkEventCrossing *event, struct desktop *desktop);
+    GdkEventCrossing *event, struct output *output);
+
+static void panel_update (struct output *output);
+static void panel_reveal_on_edge (struct output *output,
+    struct element *element);
+static struct wallpaper *wallpaper_get (struct desktop *desktop,
+    gint width, gint height, gint scale);
+static void output_set_wallpaper (struct output *output,
+    struct wallpaper *wallpaper);
+
+/* what the helper is asked to move, slide or fade until the matching
+ * helper_batch_commit() all starts on the same frame, so the panel,
+ * clock, grid and curtain move as one. these nest, and do nothing
+ * with an older helper. */
+static void
+helper_batch_begin (struct desktop *desktop)
+{
+  if (desktop->batch_depth++ == 0
+      && shell_helper_get_version (desktop->helper) >= 10)
+    shell_helper_begin_batch (desktop->helper);
+}
 
-static gboolean
-connect_enter_leave_signals (gpointer data)
+static void
+helper_batch_commit (struct desktop *desktop)
 {
-  struct desktop *desktop = data;
-  GList *l;
+  if (--desktop->batch_depth == 0
+      && shell_helper_get_version (desktop->helper) >= 10)
+    shell_helper_commit_batch (desktop->helper);
+}
 
-  g_signal_connect (desktop->panel->window, "enter-notify-event",
-      G_CALLBACK (panel_window_enter_cb), desktop);
-  g_signal_connect (desktop->panel->window, "leave-notify-event",
-      G_CALLBACK (panel_window_leave_cb), desktop);
+static void
+helper_set_animations (struct desktop *desktop)
+{
+  if (shell_helper_get_version (desktop->helper) < 11)
+    return;
+
+  shell_helper_set_animation (desktop->helper,
+      SHELL_HELPER_ANIMATION_KIND_SLIDE,
+      g_settings_get_enum (desktop->settings, "slide-animation"),
+      g_settings_get_uint (desktop->settings, "slide-duration"));
+  shell_helper_set_animation (desktop->helper,
+      SHELL_HELPER_ANIMATION_KIND_CURTAIN,
+      g_settings_get_enum (desktop->settings, "curtain-animation"),
+      g_settings_get_uint (desktop->settings, "curtain-duration"));
+}
+
+static void
+animation_settings_changed_cb (GSettings *settings,
+    const gchar *key,
+    struct desktop *desktop)
+{
+  if (g_str_has_prefix (key, "slide-")
+      || g_str_has_prefix (key, "curtain-"))
+    helper_set_animations (desktop);
+}
 
-  g_signal_connect (desktop->clock->window, "enter-notify-event",
-      G_CALLBACK (panel_window_enter_cb), desktop);
-  g_signal_connect (desktop->clock->window, "leave-notify-event",
-      G_CALLBACK (panel_window_leave_cb), desktop);
+static void
+connect_enter_leave_signals (struct output *output,
+    struct element *element)
+{
+  g_signal_connect (element->window, "enter-notify-event",
+      G_CALLBACK (panel_window_enter_cb), output);
+  g_signal_connect (element->window, "leave-notify-event",
+      G_CALLBACK (panel_window_leave_cb), output);
+}
 
-  g_signal_connect (desktop->launcher_grid->window, "enter-notify-event",
-      G_CALLBACK (panel_window_enter_cb), desktop);
-  g_signal_connect (desktop->launcher_grid->window, "leave-notify-event",
-      G_CALLBACK (panel_window_leave_cb), desktop);
+/* the shell configures the background and the panel of an output,
+ * both with the size of the output */
+static struct output *
+output_for_surface (struct desktop *desktop,
+    struct wl_surface *surface)
+{
+  struct output *output;
 
-  return G_SOURCE_REMOVE;
+  wl_list_for_each (output, &desktop->outputs, link)
+    {
+      if ((output->background && output->background->surface == surface)
+          || (output->panel && output->panel->surface == surface))
+        return output;
+    }
+
+  return NULL;
 }
 
+static void launcher_grid_toggle (GtkWidget *widget,
+    struct output *output);
+
 static void
-shell_configure (struct desktop *desktop,
-    uint32_t edges,
-    struct wl_surface *surface,
-    int32_t width, int32_t height)
+output_layout (struct output *output,
+    gint width,
+    gint height)
 {
-  int window_height;
+  struct desktop *desktop = output->desktop;
+  MaynardLayout *layout = &output->layout;
   int grid_width, grid_height;
 
-  gtk_widget_set_size_request (desktop->background->window,
+  output->left = output->x;
+  output->top = output->y;
+  output->width = width;
+  output->height = height;
+
+  /* the grid is slid out by the old layout's distance, so put it
+   * away rather than leave it half on screen */
+  if (output->grid_visible)
+    launcher_grid_toggle (output->launcher_grid->window, output);
+
+  gtk_widget_set_size_request (output->background->window,
       width, height);
 
-  /* TODO: make this height a little nicer */
-  window_height = height * MAYNARD_PANEL_HEIGHT_RATIO;
-  gtk_window_resize (GTK_WINDOW (desktop->panel->window),
-      MAYNARD_PANEL_WIDTH, window_height);
+  /* the clock and the grid may not be there yet, see
+   * startup_clocks_idle_cb() */
+  grid_width = grid_height = 0;
+  if (output->launcher_grid != NULL)
+    {
+      maynard_launcher_calculate (
+          MAYNARD_LAUNCHER (output->launcher_grid->window),
+          &grid_width, &grid_height, NULL);
+      gtk_widget_set_size_request (output->launcher_grid->window,
+          grid_width, grid_height);
+    }
 
-  maynard_launcher_calculate (MAYNARD_LAUNCHER (desktop->launcher_grid->window),
-      &grid_width, &grid_height, NULL);
-  gtk_widget_set_size_request (desktop->launcher_grid->window,
+  maynard_layout_compute (layout, desktop->edge, width, height,
       grid_width, grid_height);
 
-  shell_helper_move_surface (desktop->helper, desktop->panel->surface,
-      0, (height - window_height) / 2);
+  helper_batch_begin (desktop);
+
+  /* the layout is within the output, the helper places surfaces in
+   * the compositor's space where every output has its own spot */
+  gtk_window_resize (GTK_WINDOW (output->panel->window),
+      layout->panel.width, layout->panel.height);
+  shell_helper_move_surface (desktop->helper, output->panel->surface,
+      output->left + layout->panel.x, output->top + layout->panel.y);
+
+  if (output->clock != NULL)
+    {
+      gtk_window_resize (GTK_WINDOW (output->clock->window),
+          layout->clock.width, layout->clock.height);
+      shell_helper_move_surface (desktop->helper, output->clock->surface,
+          output->left + layout->clock.x, output->top + layout->clock.y);
+    }
+
+  if (output->launcher_grid != NULL)
+    shell_helper_move_surface (desktop->helper,
+        output->launcher_grid->surface,
+        output->left + layout->grid.x, output->top + layout->grid.y);
+
+  helper_batch_commit (desktop);
+}
+
+/* everything which depends on the position, size or scale of the
+ * output, and nothing else; the elements themselves are kept */
+static void
+output_relayout (struct output *output,
+    gint width,
+    gint height)
+{
+  /* an output moved by rearranging the screens keeps its size */
+  if (output->width != width || output->height != height
+      || output->left != output->x || output->top != output->y)
+    output_layout (output, width, height);
+
+  /* gtk only learns the scale once a surface is shown on the output,
+   * and picks the buffer scale itself from then on. the wallpaper is
+   * rendered for the output's scale right away, so it is not decoded
+   * once for a guess and again for the real thing. */
+  output_set_wallpaper (output, wallpaper_get (output->desktop,
+      width, height, output->scale));
+}
 
-  gtk_window_resize (GTK_WINDOW (desktop->clock->window),
-      MAYNARD_CLOCK_WIDTH, MAYNARD_CLOCK_HEIGHT);
+static gboolean startup_clocks_idle_cb (gpointer data);
 
-  shell_helper_move_surface (desktop->helper, desktop->clock->surface,
-      MAYNARD_PANEL_WIDTH, (height - window_height) / 2);
+/* the startup trace covers everything up to both desktop_ready and
+ * the last launcher grid, whichever comes last */
+static void
+startup_report (struct desktop *desktop)
+{
+  if (desktop->ready && desktop->grids_done)
+    maynard_trace_report ();
+}
 
-  shell_helper_move_surface (desktop->helper,
-      desktop->launcher_grid->surface,
-      - grid_width,
-      ((height - window_height) / 2) + MAYNARD_CLOCK_HEIGHT);
+static void
+desktop_send_ready (struct desktop *desktop)
+{
+  if (desktop->ready)
+    return;
 
   if (desktop->shell)
-      desktop_shell_desktop_ready (desktop->shell);
+    desktop_shell_desktop_ready (desktop->shell);
   else
-      weston_desktop_shell_desktop_ready (desktop->wshell);
+    weston_desktop_shell_desktop_ready (desktop->wshell);
+
+  desktop->ready = TRUE;
+  desktop->ready_output = NULL;
+
+  maynard_trace_mark ("desktop ready");
+  startup_report (desktop);
+
+  /* the rest now that the desktop is on screen */
+  g_idle_add_full (G_PRIORITY_DEFAULT_IDLE, startup_clocks_idle_cb,
+      desktop, NULL);
+}
+
+static void
+ready_after_paint_cb (GdkFrameClock *frame_clock,
+    struct desktop *desktop)
+{
+  g_signal_handlers_disconnect_by_func (frame_clock,
+      ready_after_paint_cb, desktop);
+
+  if (--desktop->ready_paints == 0)
+    desktop_send_ready (desktop);
+}
+
+/* the compositor shows the desktop once it is ready, so that should
+ * be as soon as the background and the panel are there at their
+ * proper size, and no later. gdk commits the surface in its own
+ * after-paint handler, which runs before ours. */
+static void
+desktop_ready_after_paint (struct output *output)
+{
+  struct desktop *desktop = output->desktop;
+  struct element *elements[] = { output->background, output->panel };
+  GdkFrameClock *frame_clock;
+  guint i;
+
+  desktop->ready_output = output;
+  desktop->ready_paints = G_N_ELEMENTS (elements);
+
+  for (i = 0; i < G_N_ELEMENTS (elements); i++)
+    {
+      frame_clock = gdk_window_get_frame_clock (
+          gtk_widget_get_window (elements[i]->window));
+      g_signal_connect (frame_clock, "after-paint",
+          G_CALLBACK (ready_after_paint_cb), desktop);
+      gtk_widget_queue_draw (elements[i]->window);
+    }
+}
+
+static void
+shell_configure (struct desktop *desktop,
+    uint32_t edges,
+    struct wl_surface *surface,
+    int32_t width, int32_t height)
+{
+  struct output *output = output_for_surface (desktop, surface);
+
+  if (output == NULL)
+    return;
 
-  /* TODO: why does the panel signal leave on drawing for
-   * startup? we don't want to have to have this silly
-   * timeout. */
-  g_timeout_add_seconds (1, connect_enter_leave_signals, desktop);
+  output_relayout (output, width, height);
+
+  if (!desktop->ready && desktop->ready_output == NULL)
+    {
+      maynard_trace_mark ("configured");
+      desktop_ready_after_paint (output);
+    }
+
+  if (output->configured)
+    return;
+
+  output->configured = TRUE;
+
+  /* a leave without an enter, as sent when the panel is first
+   * drawn, is ignored by the state machine, so there is no need to
+   * wait before listening. the panel starts out shown and slides
+   * away unless the pointer is already on it. */
+  connect_enter_leave_signals (output, output->panel);
+  panel_reveal_on_edge (output, output->panel);
+  if (output->clock != NULL)
+    {
+      connect_enter_leave_signals (output, output->clock);
+      panel_reveal_on_edge (output, output->clock);
+    }
+  if (output->launcher_grid != NULL)
+    connect_enter_leave_signals (output, output->launcher_grid);
+  panel_update (output);
 }
 
 static void
@@ -213,72 +624,250 @@ static const struct weston_desktop_shell_listener wshell_listener = {
   weston_desktop_shell_grab_cursor
 };
 
+/* the compositor draws the curtain itself; an older helper would
+ * need a client buffer for it, so there is simply no curtain then.
+ * it covers every output, so it stays while any grid is open. */
+static void
+curtain_update (struct desktop *desktop)
+{
+  struct output *output;
+  gboolean show = FALSE;
+
+  if (shell_helper_get_version (desktop->helper) < 3)
+    return;
+
+  wl_list_for_each (output, &desktop->outputs, link)
+    show |= output->grid_visible;
+
+  shell_helper_curtain (desktop->helper, NULL, show);
+}
+
+/* an open grid takes the keyboard, so it can be searched and moved
+ * through with the arrow keys; closing the last one gives it back */
+static void
+keyboard_update (struct desktop *desktop)
+{
+  struct output *output;
+
+  if (shell_helper_get_version (desktop->helper) < 8)
+    return;
+
+  wl_list_for_each (output, &desktop->outputs, link)
+    {
+      if (output->grid_visible)
+        {
+          shell_helper_keyboard_focus (desktop->helper,
+              output->launcher_grid->surface);
+          return;
+        }
+    }
+
+  shell_helper_keyboard_focus (desktop->helper, NULL);
+}
+
 static void
 launcher_grid_toggle (GtkWidget *widget,
-    struct desktop *desktop)
+    struct output *output)
 {
-  if (desktop->grid_visible)
+  struct desktop *desktop = output->desktop;
+
+  /* still being made */
+  if (output->launcher_grid == NULL)
+    return;
+
+  helper_batch_begin (desktop);
+
+  if (output->grid_visible)
     {
       shell_helper_slide_surface_back (desktop->helper,
-          desktop->launcher_grid->surface);
-
-      shell_helper_curtain (desktop->helper, desktop->curtain->surface, 0);
+          output->launcher_grid->surface);
     }
   else
     {
-      int width;
+      maynard_launcher_reset (
+          MAYNARD_LAUNCHER (output->launcher_grid->window));
+      shell_helper_slide_surface (desktop->helper,
+          output->launcher_grid->surface,
+          output->layout.grid.slide_x, output->layout.grid.slide_y);
+    }
 
-      gtk_widget_get_size_request (desktop->launcher_grid->window,
-          &width, NULL);
+  output->grid_visible = !output->grid_visible;
 
-      shell_helper_slide_surface (desktop->helper,
-          desktop->launcher_grid->surface,
-          width + MAYNARD_PANEL_WIDTH, 0);
+  curtain_update (desktop);
+  keyboard_update (desktop);
+  panel_update (output);
+
+  helper_batch_commit (desktop);
+}
+
+static void panel_dismiss (struct output *output);
+
+static void
+launcher_dismiss_cb (MaynardLauncher *launcher,
+    struct output *output)
+{
+  panel_dismiss (output);
+}
+
+static void
+launcher_app_launched_cb (MaynardLauncher *launcher,
+    struct output *output)
+{
+  /* a panel swiped in goes away with the grid */
+  output->touch_shown = FALSE;
+  launcher_grid_toggle (GTK_WIDGET (launcher), output);
+}
+
+/* a swipe needs to be this long and this fast, in pixels and pixels
+ * per ms, so that a sloppy tap stays a tap */
+#define SWIPE_MIN_DISTANCE 40
+#define SWIPE_MIN_SPEED 0.3
+
+static void
+edge_inward (MaynardLayoutEdge edge,
+    gdouble *dx,
+    gdouble *dy)
+{
+  *dx = edge == MAYNARD_LAYOUT_EDGE_LEFT ? 1
+      : edge == MAYNARD_LAYOUT_EDGE_RIGHT ? -1 : 0;
+  *dy = edge == MAYNARD_LAYOUT_EDGE_TOP ? 1
+      : edge == MAYNARD_LAYOUT_EDGE_BOTTOM ? -1 : 0;
+}
+
+/* follows one finger at a time. once it lets go, gives how far and
+ * how fast it went away from the panel's edge; negative is towards
+ * it. the events still go on to gtk, so taps and scrolling work. */
+static gboolean
+swipe_track (struct output *output,
+    GdkEventTouch *event,
+    gdouble *distance,
+    gdouble *speed)
+{
+  gdouble dx, dy, vx, vy;
+
+  if (event->type == GDK_TOUCH_BEGIN)
+    {
+      if (output->swipe_sequence != NULL)
+        return FALSE;
 
-      shell_helper_curtain (desktop->helper, desktop->curtain->surface, 1);
+      output->swipe_sequence = event->sequence;
+      output->swipe_x = event->x;
+      output->swipe_y = event->y;
+      maynard_velocity_reset (&output->swipe_velocity);
+    }
+  else if (event->sequence != output->swipe_sequence)
+    {
+      return FALSE;
     }
 
-  desktop->grid_visible = !desktop->grid_visible;
+  maynard_velocity_add (&output->swipe_velocity, event->time,
+      event->x, event->y);
+
+  if (event->type != GDK_TOUCH_END && event->type != GDK_TOUCH_CANCEL)
+    return FALSE;
+
+  output->swipe_sequence = NULL;
+  if (event->type == GDK_TOUCH_CANCEL)
+    return FALSE;
+
+  edge_inward (output->desktop->edge, &dx, &dy);
+  maynard_velocity_get (&output->swipe_velocity, &vx, &vy);
+
+  *distance = (event->x - output->swipe_x) * dx
+      + (event->y - output->swipe_y) * dy;
+  *speed = vx * dx + vy * dy;
+
+  return TRUE;
+}
+
+/* swiping away from the panel opens the grid */
+static gboolean
+panel_touch_event_cb (GtkWidget *widget,
+    GdkEventTouch *event,
+    struct output *output)
+{
+  gdouble distance, speed;
+
+  if (swipe_track (output, event, &distance, &speed)
+      && distance > SWIPE_MIN_DISTANCE && speed > SWIPE_MIN_SPEED
+      && !output->grid_visible)
+    launcher_grid_toggle (widget, output);
+
+  return FALSE;
+}
+
+/* and swiping back towards it closes it again, unless the finger was
+ * scrolling the grid and had not reached the end yet */
+static gboolean
+grid_touch_event_cb (GtkWidget *widget,
+    GdkEventTouch *event,
+    struct output *output)
+{
+  gdouble distance, speed, dx, dy;
+
+  if (!swipe_track (output, event, &distance, &speed)
+      || distance > -SWIPE_MIN_DISTANCE || speed > -SWIPE_MIN_SPEED
+      || !output->grid_visible)
+    return FALSE;
+
+  edge_inward (output->desktop->edge, &dx, &dy);
+  if (maynard_launcher_can_scroll (MAYNARD_LAUNCHER (widget),
+          dy * distance))
+    return FALSE;
+
+  panel_dismiss (output);
+
+  return FALSE;
 }
 
 static void
-launcher_grid_create (struct desktop *desktop)
+launcher_grid_create (struct output *output)
 {
+  struct desktop *desktop = output->desktop;
   struct element *launcher_grid;
   GdkWindow *gdk_window;
 
   launcher_grid = malloc (sizeof *launcher_grid);
   memset (launcher_grid, 0, sizeof *launcher_grid);
 
-  launcher_grid->window = maynard_launcher_new (desktop->background->window);
+  launcher_grid->window = maynard_launcher_new (output->background->window,
+      desktop->edge);
   gdk_window = gtk_widget_get_window (launcher_grid->window);
   launcher_grid->surface = gdk_wayland_window_get_wl_surface (gdk_window);
 
   gdk_wayland_window_set_use_custom_surface (gdk_window);
   shell_helper_add_surface_to_layer (desktop->helper,
       launcher_grid->surface,
-      desktop->panel->surface);
+      output->panel->surface);
 
   g_signal_connect (launcher_grid->window, "app-launched",
-      G_CALLBACK (launcher_grid_toggle), desktop);
+      G_CALLBACK (launcher_app_launched_cb), output);
+  g_signal_connect (launcher_grid->window, "dismiss",
+      G_CALLBACK (launcher_dismiss_cb), output);
+
+  gtk_widget_add_events (launcher_grid->window, GDK_TOUCH_MASK);
+  g_signal_connect (launcher_grid->window, "touch-event",
+      G_CALLBACK (grid_touch_event_cb), output);
 
   gtk_widget_show_all (launcher_grid->window);
 
-  desktop->launcher_grid = launcher_grid;
+  element_track_regions (launcher_grid);
+
+  output->launcher_grid = launcher_grid;
 }
 
 static void
 volume_changed_cb (MaynardClock *clock,
     gdouble value,
     const gchar *icon_name,
-    struct desktop *desktop)
+    struct output *output)
 {
   maynard_panel_set_volume_icon_name (
-      MAYNARD_PANEL (desktop->panel->window), icon_name);
+      MAYNARD_PANEL (output->panel->window), icon_name);
 }
 
-static GtkWidget *
-clock_create (struct desktop *desktop)
+static void
+clock_create (struct output *output)
 {
   struct element *clock;
   GdkWindow *gdk_window;
@@ -289,367 +878,1036 @@ clock_create (struct desktop *desktop)
   clock->window = maynard_clock_new ();
 
   g_signal_connect (clock->window, "volume-changed",
-      G_CALLBACK (volume_changed_cb), desktop);
+      G_CALLBACK (volume_changed_cb), output);
 
   gdk_window = gtk_widget_get_window (clock->window);
   clock->surface = gdk_wayland_window_get_wl_surface (gdk_window);
 
   gdk_wayland_window_set_use_custom_surface (gdk_window);
-  shell_helper_add_surface_to_layer (desktop->helper, clock->surface,
-      desktop->panel->surface);
+  shell_helper_add_surface_to_layer (output->desktop->helper, clock->surface,
+      output->panel->surface);
 
   gtk_widget_show_all (clock->window);
 
-  desktop->clock = clock;
+  element_track_regions (clock);
+
+  output->clock = clock;
 }
 
 static void
-button_toggled_cb (struct desktop *desktop,
+button_toggled_cb (struct output *output,
     gboolean *visible,
     gboolean *not_visible)
 {
+  /* the clock is what shows them */
+  if (output->clock == NULL)
+    return;
+
   *visible = !*visible;
   *not_visible = FALSE;
 
-  if (desktop->system_visible)
+  if (output->system_visible)
     {
-      maynard_clock_show_section (MAYNARD_CLOCK (desktop->clock->window),
+      maynard_clock_show_section (MAYNARD_CLOCK (output->clock->window),
           MAYNARD_CLOCK_SECTION_SYSTEM);
-      maynard_panel_show_previous (MAYNARD_PANEL (desktop->panel->window),
+      maynard_panel_show_previous (MAYNARD_PANEL (output->panel->window),
           MAYNARD_PANEL_BUTTON_SYSTEM);
     }
-  else if (desktop->volume_visible)
+  else if (output->volume_visible)
     {
-      maynard_clock_show_section (MAYNARD_CLOCK (desktop->clock->window),
+      maynard_clock_show_section (MAYNARD_CLOCK (output->clock->window),
           MAYNARD_CLOCK_SECTION_VOLUME);
-      maynard_panel_show_previous (MAYNARD_PANEL (desktop->panel->window),
+      maynard_panel_show_previous (MAYNARD_PANEL (output->panel->window),
           MAYNARD_PANEL_BUTTON_VOLUME);
     }
   else
     {
-      maynard_clock_show_section (MAYNARD_CLOCK (desktop->clock->window),
+      maynard_clock_show_section (MAYNARD_CLOCK (output->clock->window),
           MAYNARD_CLOCK_SECTION_CLOCK);
-      maynard_panel_show_previous (MAYNARD_PANEL (desktop->panel->window),
+      maynard_panel_show_previous (MAYNARD_PANEL (output->panel->window),
           MAYNARD_PANEL_BUTTON_NONE);
     }
 }
 
 static void
 system_toggled_cb (GtkWidget *widget,
-    struct desktop *desktop)
+    struct output *output)
 {
-  button_toggled_cb (desktop,
-      &desktop->system_visible,
-      &desktop->volume_visible);
+  button_toggled_cb (output,
+      &output->system_visible,
+      &output->volume_visible);
 }
 
 static void
 volume_toggled_cb (GtkWidget *widget,
-    struct desktop *desktop)
+    struct output *output)
 {
-  button_toggled_cb (desktop,
-      &desktop->volume_visible,
-      &desktop->system_visible);
+  button_toggled_cb (output,
+      &output->volume_visible,
+      &output->system_visible);
 }
 
-static gboolean
-panel_window_enter_cb (GtkWidget *widget,
-    GdkEventCrossing *event,
-    struct desktop *desktop)
+static void
+clock_slide_out (struct output *output)
 {
-  if (desktop->initial_panel_timeout_id > 0)
-    {
-      g_source_remove (desktop->initial_panel_timeout_id);
-      desktop->initial_panel_timeout_id = 0;
-    }
+  gint width, height;
+  gint slide_x, slide_y;
+
+  /* the clock may have ended up bigger than we asked for */
+  gtk_window_get_size (GTK_WINDOW (output->clock->window),
+      &width, &height);
+  maynard_layout_get_hide_slide (&output->layout, width, height,
+      &slide_x, &slide_y);
+
+  shell_helper_slide_surface (output->desktop->helper,
+      output->clock->surface,
+      slide_x, slide_y);
+}
 
-  if (desktop->hide_panel_idle_id > 0)
-    {
-      g_source_remove (desktop->hide_panel_idle_id);
-      desktop->hide_panel_idle_id = 0;
-      return FALSE;
+static void
+panel_slide (struct output *output,
+    gboolean show)
+{
+  struct desktop *desktop = output->desktop;
+
+  helper_batch_begin (desktop);
+
+  if (show)
+    {
+      shell_helper_slide_surface_back (desktop->helper,
+          output->panel->surface);
+      if (output->clock != NULL)
+        shell_helper_slide_surface_back (desktop->helper,
+            output->clock->surface);
+
+      maynard_panel_set_expand (MAYNARD_PANEL (output->panel->window), TRUE);
+
+      output->panel_state = PANEL_STATE_SHOWING;
+    }
+  else
+    {
+      shell_helper_slide_surface (desktop->helper,
+          output->panel->surface,
+          output->layout.panel.slide_x, output->layout.panel.slide_y);
+
+      maynard_panel_set_expand (MAYNARD_PANEL (output->panel->window),
+          FALSE);
+
+      if (output->clock != NULL)
+        {
+          clock_slide_out (output);
+          maynard_clock_show_section (MAYNARD_CLOCK (output->clock->window),
+              MAYNARD_CLOCK_SECTION_CLOCK);
+        }
+      maynard_panel_show_previous (MAYNARD_PANEL (output->panel->window),
+          MAYNARD_PANEL_BUTTON_NONE);
+      output->system_visible = FALSE;
+      output->volume_visible = FALSE;
+
+      output->panel_state = PANEL_STATE_HIDING;
     }
 
-  if (desktop->pointer_out_of_panel)
+  helper_batch_commit (desktop);
+
+  /* an older helper does not tell us when it is done */
+  if (shell_helper_get_version (desktop->helper) < 5)
+    output->panel_state = show ? PANEL_STATE_SHOWN : PANEL_STATE_HIDDEN;
+}
+
+/* the one place deciding whether the panel should move */
+static void
+panel_update (struct output *output)
+{
+  gboolean want_shown = output->pointer_in_panel || output->grid_visible
+      || output->touch_shown;
+
+  switch (output->panel_state)
     {
-      desktop->pointer_out_of_panel = FALSE;
-      return FALSE;
+      case PANEL_STATE_SHOWN:
+        if (!want_shown)
+          panel_slide (output, FALSE);
+        break;
+      case PANEL_STATE_HIDDEN:
+        if (want_shown)
+          panel_slide (output, TRUE);
+        break;
+      case PANEL_STATE_HIDING:
+        /* the helper turns the slide around where it is */
+        if (want_shown)
+          panel_slide (output, TRUE);
+        break;
+      case PANEL_STATE_SHOWING:
+        if (!want_shown)
+          panel_slide (output, FALSE);
+        break;
     }
+}
 
-  shell_helper_slide_surface_back (desktop->helper,
-      desktop->panel->surface);
-  shell_helper_slide_surface_back (desktop->helper,
-      desktop->clock->surface);
+static void
+panel_slide_done (struct output *output)
+{
+  if (output->panel_state == PANEL_STATE_SHOWING)
+    output->panel_state = PANEL_STATE_SHOWN;
+  else if (output->panel_state == PANEL_STATE_HIDING)
+    output->panel_state = PANEL_STATE_HIDDEN;
+
+  /* the helper may have revealed the panel without the pointer ever
+   * entering it */
+  panel_update (output);
+}
 
-  maynard_panel_set_expand (MAYNARD_PANEL (desktop->panel->window), TRUE);
+/* how long after time the panel started to slide in. time is an
+ * event timestamp, which is CLOCK_MONOTONIC in milliseconds too,
+ * wrapped to 32 bits. */
+static void
+panel_latency_add (guint32 time,
+    const gchar *name)
+{
+  gint64 now = g_get_monotonic_time ();
+  guint32 elapsed = (guint32) (now / 1000) - time;
 
-  return FALSE;
+  maynard_trace_latency (now - (gint64) elapsed * 1000, name);
 }
 
-static gboolean
-leave_panel_idle_cb (gpointer data)
+/* the helper already started sliding the panel and clock back, so
+ * only catch up with it. time is when it did, or 0 from a helper too
+ * old to say. */
+static void
+panel_edge_revealed (struct output *output,
+    guint32 time)
 {
-  struct desktop *desktop = data;
-  gint width;
+  if (output->panel_state == PANEL_STATE_SHOWN
+      || output->panel_state == PANEL_STATE_SHOWING)
+    return;
 
-  desktop->hide_panel_idle_id = 0;
+  maynard_panel_set_expand (MAYNARD_PANEL (output->panel->window), TRUE);
+  output->panel_state = PANEL_STATE_SHOWING;
 
-  gtk_window_get_size (GTK_WINDOW (desktop->clock->window),
-      &width, NULL);
+  if (time != 0)
+    panel_latency_add (time, "panel edge reveal reaching the shell");
+}
 
-  shell_helper_slide_surface (desktop->helper,
-      desktop->panel->surface,
-      MAYNARD_VERTICAL_CLOCK_WIDTH - MAYNARD_PANEL_WIDTH, 0);
-  shell_helper_slide_surface (desktop->helper,
-      desktop->clock->surface,
-      MAYNARD_VERTICAL_CLOCK_WIDTH - MAYNARD_PANEL_WIDTH - width, 0);
+/* let the compositor reveal the panel as soon as the pointer reaches
+ * the edge, instead of waiting for us to see the enter event */
+static void
+panel_reveal_on_edge (struct output *output,
+    struct element *element)
+{
+  struct desktop *desktop = output->desktop;
+  GSettings *settings;
+  guint zone;
 
-  maynard_panel_set_expand (MAYNARD_PANEL (desktop->panel->window), FALSE);
+  if (shell_helper_get_version (desktop->helper) < 6)
+    return;
 
-  maynard_clock_show_section (MAYNARD_CLOCK (desktop->clock->window),
-      MAYNARD_CLOCK_SECTION_CLOCK);
-  maynard_panel_show_previous (MAYNARD_PANEL (desktop->panel->window),
-      MAYNARD_PANEL_BUTTON_NONE);
-  desktop->system_visible = FALSE;
-  desktop->volume_visible = FALSE;
-  desktop->pointer_out_of_panel = FALSE;
+  settings = g_settings_new ("org.raspberrypi.maynard");
+  zone = g_settings_get_uint (settings, "panel-edge-zone");
+  g_object_unref (settings);
 
-  return G_SOURCE_REMOVE;
+  shell_helper_reveal_on_edge (desktop->helper,
+      element->surface, zone);
 }
 
 static gboolean
-panel_window_leave_cb (GtkWidget *widget,
+panel_window_enter_cb (GtkWidget *widget,
     GdkEventCrossing *event,
-    struct desktop *desktop)
+    struct output *output)
 {
-  if (desktop->initial_panel_timeout_id > 0)
-    {
-      g_source_remove (desktop->initial_panel_timeout_id);
-      desktop->initial_panel_timeout_id = 0;
-    }
+  PanelState state = output->panel_state;
 
-  if (desktop->hide_panel_idle_id > 0)
+  if (event->detail == GDK_NOTIFY_INFERIOR)
     return FALSE;
 
-  if (desktop->grid_visible)
+  /* moving from one of our surfaces to another */
+  if (output->panel_leave_idle_id > 0)
     {
-      desktop->pointer_out_of_panel = TRUE;
-      return FALSE;
+      maynard_activity_idle_remove (maynard_activity_get_default (),
+          output->panel_leave_idle_id);
+      output->panel_leave_idle_id = 0;
     }
 
-  desktop->hide_panel_idle_id = g_idle_add (leave_panel_idle_cb, desktop);
+  output->pointer_in_panel = TRUE;
+  panel_update (output);
+
+  /* only when the enter is what started the slide */
+  if ((state == PANEL_STATE_HIDDEN || state == PANEL_STATE_HIDING)
+      && state != output->panel_state)
+    panel_latency_add (event->time, "panel slide after pointer enter");
 
   return FALSE;
 }
 
 static gboolean
-panel_hide_timeout_cb (gpointer data)
+panel_leave_idle_cb (gpointer data)
 {
-  struct desktop *desktop = data;
+  struct output *output = data;
 
-  panel_window_leave_cb (NULL, NULL, desktop);
+  output->panel_leave_idle_id = 0;
+  output->pointer_in_panel = FALSE;
+  panel_update (output);
 
   return G_SOURCE_REMOVE;
 }
 
+static gboolean
+panel_window_leave_cb (GtkWidget *widget,
+    GdkEventCrossing *event,
+    struct output *output)
+{
+  if (event->detail == GDK_NOTIFY_INFERIOR || !output->pointer_in_panel
+      || output->panel_leave_idle_id > 0)
+    return FALSE;
+
+  /* the enter for the surface the pointer moved to, if it is one of
+   * ours, is already queued; only act once it had a chance to run */
+  output->panel_leave_idle_id = maynard_activity_idle_add (
+      maynard_activity_get_default (), panel_leave_idle_cb, output);
+
+  return FALSE;
+}
+
+/* a click outside the panel, or on a favorite, puts everything away
+ * even though the pointer may still be on top of the panel */
+static void
+panel_dismiss (struct output *output)
+{
+  if (output->panel_leave_idle_id > 0)
+    {
+      maynard_activity_idle_remove (maynard_activity_get_default (),
+          output->panel_leave_idle_id);
+      output->panel_leave_idle_id = 0;
+    }
+
+  output->pointer_in_panel = FALSE;
+  output->touch_shown = FALSE;
+
+  if (output->grid_visible)
+    launcher_grid_toggle (output->launcher_grid->window, output);
+  else
+    panel_update (output);
+}
+
 static void
 favorite_launched_cb (MaynardPanel *panel,
-    struct desktop *desktop)
+    struct output *output)
 {
-  if (desktop->grid_visible)
-    launcher_grid_toggle (desktop->launcher_grid->window, desktop);
+  panel_dismiss (output);
+}
 
-  panel_window_leave_cb (NULL, NULL, desktop);
+/* the same values in both shell protocols */
+static uint32_t
+panel_position (MaynardLayoutEdge edge)
+{
+  switch (edge)
+    {
+      case MAYNARD_LAYOUT_EDGE_RIGHT:
+        return DESKTOP_SHELL_PANEL_POSITION_RIGHT;
+      case MAYNARD_LAYOUT_EDGE_TOP:
+        return DESKTOP_SHELL_PANEL_POSITION_TOP;
+      case MAYNARD_LAYOUT_EDGE_BOTTOM:
+        return DESKTOP_SHELL_PANEL_POSITION_BOTTOM;
+      case MAYNARD_LAYOUT_EDGE_LEFT:
+      default:
+        return DESKTOP_SHELL_PANEL_POSITION_LEFT;
+    }
 }
 
 static void
-panel_create (struct desktop *desktop)
+panel_create (struct output *output)
 {
+  struct desktop *desktop = output->desktop;
   struct element *panel;
   GdkWindow *gdk_window;
 
   panel = malloc (sizeof *panel);
   memset (panel, 0, sizeof *panel);
 
-  panel->window = maynard_panel_new ();
+  panel->window = maynard_panel_new (desktop->edge);
 
   g_signal_connect (panel->window, "app-menu-toggled",
-      G_CALLBACK (launcher_grid_toggle), desktop);
+      G_CALLBACK (launcher_grid_toggle), output);
   g_signal_connect (panel->window, "system-toggled",
-      G_CALLBACK (system_toggled_cb), desktop);
+      G_CALLBACK (system_toggled_cb), output);
   g_signal_connect (panel->window, "volume-toggled",
-      G_CALLBACK (volume_toggled_cb), desktop);
+      G_CALLBACK (volume_toggled_cb), output);
   g_signal_connect (panel->window, "favorite-launched",
-      G_CALLBACK (favorite_launched_cb), desktop);
+      G_CALLBACK (favorite_launched_cb), output);
 
-  desktop->initial_panel_timeout_id =
-    g_timeout_add_seconds (2, panel_hide_timeout_cb, desktop);
+  gtk_widget_add_events (panel->window, GDK_TOUCH_MASK);
+  g_signal_connect (panel->window, "touch-event",
+      G_CALLBACK (panel_touch_event_cb), output);
 
   /* set it up as the panel */
   gdk_window = gtk_widget_get_window (panel->window);
   gdk_wayland_window_set_use_custom_surface (gdk_window);
 
-  panel->surface = gdk_wayland_window_get_wl_surface (gdk_window);
-  if (desktop->shell)
-    {
-      desktop_shell_set_user_data (desktop->shell, desktop);
-      desktop_shell_set_panel (desktop->shell, desktop->output, panel->surface);
-      desktop_shell_set_panel_position (desktop->shell,
-	  DESKTOP_SHELL_PANEL_POSITION_LEFT);
-    }
-  else
+  panel->surface = gdk_wayland_window_get_wl_surface (gdk_window);
+  if (desktop->shell)
+    {
+      desktop_shell_set_user_data (desktop->shell, desktop);
+      desktop_shell_set_panel (desktop->shell, output->output, panel->surface);
+      desktop_shell_set_panel_position (desktop->shell,
+	  panel_position (desktop->edge));
+    }
+  else
+    {
+      weston_desktop_shell_set_user_data (desktop->wshell, desktop);
+      weston_desktop_shell_set_panel (desktop->wshell, output->output,
+          panel->surface);
+      weston_desktop_shell_set_panel_position (desktop->wshell,
+	  panel_position (desktop->edge));
+    }
+  shell_helper_set_panel (desktop->helper, panel->surface);
+
+  gtk_widget_show_all (panel->window);
+
+  element_track_regions (panel);
+
+  output->panel = panel;
+}
+
+/* the background is opaque, so there is nothing to blend with */
+static void
+paint_image (cairo_t *cr,
+    cairo_surface_t *image)
+{
+  cairo_rectangle_list_t *rects;
+  gint i;
+
+  cairo_set_operator (cr, CAIRO_OPERATOR_SOURCE);
+
+  if (image != NULL)
+    {
+      cairo_set_source_surface (cr, image, 0, 0);
+      /* a wallpaper smaller than the output is stretched at the edges
+       * rather than leaving a hole in the opaque region */
+      cairo_pattern_set_extend (cairo_get_source (cr), CAIRO_EXTEND_PAD);
+    }
+  else
+    {
+      cairo_set_source_rgb (cr,
+          MAYNARD_WALLPAPER_PLACEHOLDER_RED,
+          MAYNARD_WALLPAPER_PLACEHOLDER_GREEN,
+          MAYNARD_WALLPAPER_PLACEHOLDER_BLUE);
+    }
+
+  /* only touch the pixels which were damaged */
+  rects = cairo_copy_clip_rectangle_list (cr);
+  if (rects->status == CAIRO_STATUS_SUCCESS)
+    {
+      for (i = 0; i < rects->num_rectangles; i++)
+        cairo_rectangle (cr, rects->rectangles[i].x, rects->rectangles[i].y,
+            rects->rectangles[i].width, rects->rectangles[i].height);
+      cairo_fill (cr);
+    }
+  else
+    {
+      cairo_paint (cr);
+    }
+  cairo_rectangle_list_destroy (rects);
+}
+
+/* Expose callback for the drawing area */
+static gboolean
+draw_cb (GtkWidget *widget,
+    cairo_t *cr,
+    gpointer data)
+{
+  struct output *output = data;
+  MaynardActivity *activity = maynard_activity_get_default ();
+
+  /* nobody can see it; paint when the output comes back instead */
+  if (!maynard_activity_is_active (activity))
+    {
+      output->background_dirty = TRUE;
+      maynard_activity_add_avoided_wakeups (activity, 1);
+      return TRUE;
+    }
+
+  paint_image (cr, output->background->image);
+
+  return TRUE;
+}
+
+/* the wallpaper may come with an alpha channel, but nothing is ever
+ * shown below the background. flatten it once onto the placeholder
+ * colour so the surface really is as opaque as we claim. */
+static cairo_surface_t *
+flatten_image (cairo_surface_t *image)
+{
+  cairo_surface_t *flat;
+  cairo_t *cr;
+
+  if (cairo_image_surface_get_format (image) == CAIRO_FORMAT_RGB24)
+    return image;
+
+  flat = cairo_image_surface_create (CAIRO_FORMAT_RGB24,
+      cairo_image_surface_get_width (image),
+      cairo_image_surface_get_height (image));
+
+#if CAIRO_VERSION >= CAIRO_VERSION_ENCODE (1, 14, 0)
+  {
+    gdouble x_scale, y_scale;
+
+    cairo_surface_get_device_scale (image, &x_scale, &y_scale);
+    cairo_surface_set_device_scale (flat, x_scale, y_scale);
+  }
+#endif
+
+  cr = cairo_create (flat);
+  cairo_set_source_rgb (cr,
+      MAYNARD_WALLPAPER_PLACEHOLDER_RED,
+      MAYNARD_WALLPAPER_PLACEHOLDER_GREEN,
+      MAYNARD_WALLPAPER_PLACEHOLDER_BLUE);
+  cairo_paint (cr);
+  cairo_set_source_surface (cr, image, 0, 0);
+  cairo_paint (cr);
+  cairo_destroy (cr);
+
+  cairo_surface_destroy (image);
+
+  return flat;
+}
+
+/* Destroy handler for the window */
+static void
+destroy_cb (GObject *object,
+    gpointer data)
+{
+  gtk_main_quit ();
+}
+
+static gboolean
+fade_draw_cb (GtkWidget *widget,
+    cairo_t *cr,
+    struct element *fade)
+{
+  /* nothing ever damages the window after its first frame; if
+   * something did, the new wallpaper would just show early */
+  if (fade->image != NULL)
+    paint_image (cr, fade->image);
+
+  return TRUE;
+}
+
+static void
+fade_after_paint_cb (GdkFrameClock *frame_clock,
+    struct output *output)
+{
+  struct element *fade = output->fade;
+
+  g_signal_handlers_disconnect_by_func (frame_clock,
+      fade_after_paint_cb, output);
+
+  /* the window's buffer has the old wallpaper now. keeping our copy
+   * as well would make three frames alive with the new one and the
+   * slideshow's next, instead of two */
+  cairo_surface_destroy (fade->image);
+  fade->image = NULL;
+
+  /* the old wallpaper is covering the background now, so it can be
+   * swapped underneath without anybody seeing it */
+  gtk_widget_queue_draw (output->background->window);
+}
+
+static void
+crossfade_finish (struct output *output)
+{
+  struct element *fade = output->fade;
+  GdkWindow *gdk_window;
+
+  if (fade == NULL)
+    return;
+
+  gdk_window = gtk_widget_get_window (fade->window);
+  g_signal_handlers_disconnect_by_func (
+      gdk_window_get_frame_clock (gdk_window),
+      fade_after_paint_cb, output);
+
+  gtk_widget_destroy (fade->window);
+  if (fade->image != NULL)
+    cairo_surface_destroy (fade->image);
+  free (fade);
+
+  output->fade = NULL;
+}
+
+/* the old wallpaper goes into a window of its own which the
+ * compositor places above the background and fades out. only then is
+ * the background redrawn with the new one. */
+static void
+crossfade_start (struct output *output,
+    cairo_surface_t *old_image)
+{
+  struct element *fade;
+  GdkWindow *gdk_window;
+
+  /* a crossfade still running is cut short */
+  crossfade_finish (output);
+
+  fade = malloc (sizeof *fade);
+  memset (fade, 0, sizeof *fade);
+  fade->image = old_image;
+
+  fade->window = gtk_window_new (GTK_WINDOW_TOPLEVEL);
+
+  g_signal_connect (fade->window, "draw",
+      G_CALLBACK (fade_draw_cb), fade);
+
+  gtk_window_set_title (GTK_WINDOW (fade->window), "maynard");
+  gtk_window_set_decorated (GTK_WINDOW (fade->window), FALSE);
+  gtk_widget_set_app_paintable (fade->window, TRUE);
+  gtk_widget_set_size_request (fade->window,
+      gtk_widget_get_allocated_width (output->background->window),
+      gtk_widget_get_allocated_height (output->background->window));
+  gtk_widget_realize (fade->window);
+
+  gdk_window = gtk_widget_get_window (fade->window);
+  gdk_wayland_window_set_use_custom_surface (gdk_window);
+
+  fade->surface = gdk_wayland_window_get_wl_surface (gdk_window);
+  shell_helper_crossfade (output->desktop->helper, fade->surface,
+      output->background->surface);
+
+  g_signal_connect (gdk_window_get_frame_clock (gdk_window), "after-paint",
+      G_CALLBACK (fade_after_paint_cb), output);
+
+  output->fade = fade;
+
+  gtk_widget_show_all (fade->window);
+}
+
+/* takes the reference on image */
+static void
+set_wallpaper (struct output *output,
+    cairo_surface_t *image,
+    gboolean crossfade)
+{
+  cairo_surface_t *old_image = output->background->image;
+
+  output->background->image = image;
+
+  if (crossfade && old_image != NULL
+      && shell_helper_get_version (output->desktop->helper) >= 4)
+    {
+      crossfade_start (output, old_image);
+      return;
+    }
+
+  if (old_image != NULL)
+    cairo_surface_destroy (old_image);
+
+  gtk_widget_queue_draw (output->background->window);
+}
+
+/* takes the reference on image */
+static void
+wallpaper_set_image (struct wallpaper *wallpaper,
+    cairo_surface_t *image,
+    gboolean crossfade)
+{
+  struct output *output;
+
+  if (wallpaper->image != NULL)
+    cairo_surface_destroy (wallpaper->image);
+  wallpaper->image = flatten_image (image);
+
+  wl_list_for_each (output, &wallpaper->desktop->outputs, link)
+    {
+      if (output->wallpaper == wallpaper)
+        set_wallpaper (output, cairo_surface_reference (wallpaper->image),
+            crossfade);
+    }
+}
+
+static void
+slideshow_frame_ready_cb (MaynardSlideshow *slideshow,
+    gpointer frame,
+    gboolean first,
+    struct wallpaper *wallpaper)
+{
+  wallpaper_set_image (wallpaper, cairo_surface_reference (frame), !first);
+}
+
+/* the placeholder colour is drawn until the wallpaper is ready, so
+ * decoding never holds up the rest of the shell */
+static struct wallpaper *
+wallpaper_get (struct desktop *desktop,
+    gint width,
+    gint height,
+    gint scale)
+{
+  struct wallpaper *wallpaper;
+
+  wl_list_for_each (wallpaper, &desktop->wallpapers, link)
+    {
+      if (wallpaper->width == width && wallpaper->height == height
+          && wallpaper->scale == scale)
+        {
+          wallpaper->ref_count++;
+          return wallpaper;
+        }
+    }
+
+  wallpaper = malloc (sizeof *wallpaper);
+  memset (wallpaper, 0, sizeof *wallpaper);
+  wallpaper->desktop = desktop;
+  wallpaper->width = width;
+  wallpaper->height = height;
+  wallpaper->scale = scale;
+  wallpaper->ref_count = 1;
+  wl_list_insert (&desktop->wallpapers, &wallpaper->link);
+
+  wallpaper->slideshow = maynard_slideshow_new (width, height, scale);
+  g_signal_connect (wallpaper->slideshow, "frame-ready",
+      G_CALLBACK (slideshow_frame_ready_cb), wallpaper);
+  maynard_slideshow_start (wallpaper->slideshow);
+
+  return wallpaper;
+}
+
+static void
+wallpaper_unref (struct wallpaper *wallpaper)
+{
+  if (--wallpaper->ref_count > 0)
+    return;
+
+  g_signal_handlers_disconnect_by_func (wallpaper->slideshow,
+      slideshow_frame_ready_cb, wallpaper);
+  g_object_unref (wallpaper->slideshow);
+
+  if (wallpaper->image != NULL)
+    cairo_surface_destroy (wallpaper->image);
+
+  wl_list_remove (&wallpaper->link);
+  free (wallpaper);
+}
+
+/* takes the reference on wallpaper */
+static void
+output_set_wallpaper (struct output *output,
+    struct wallpaper *wallpaper)
+{
+  if (output->wallpaper == wallpaper)
+    {
+      wallpaper_unref (wallpaper);
+      return;
+    }
+
+  if (output->wallpaper != NULL)
+    wallpaper_unref (output->wallpaper);
+
+  output->wallpaper = wallpaper;
+
+  /* another output of the same size may have it ready already */
+  if (wallpaper->image != NULL)
+    set_wallpaper (output, cairo_surface_reference (wallpaper->image),
+        FALSE);
+}
+
+static void
+background_create (struct output *output)
+{
+  struct desktop *desktop = output->desktop;
+  GdkWindow *gdk_window;
+  struct element *background;
+  gint64 begin = maynard_trace_begin ();
+
+  background = malloc (sizeof *background);
+  memset (background, 0, sizeof *background);
+  background->opaque = TRUE;
+
+  background->window = gtk_window_new (GTK_WINDOW_TOPLEVEL);
+
+  g_signal_connect (background->window, "destroy",
+      G_CALLBACK (destroy_cb), NULL);
+
+  g_signal_connect (background->window, "draw",
+      G_CALLBACK (draw_cb), output);
+
+  gtk_window_set_title (GTK_WINDOW (background->window), "maynard");
+  gtk_window_set_decorated (GTK_WINDOW (background->window), FALSE);
+  gtk_widget_set_app_paintable (background->window, TRUE);
+  gtk_widget_realize (background->window);
+
+  gdk_window = gtk_widget_get_window (background->window);
+  gdk_wayland_window_set_use_custom_surface (gdk_window);
+
+  background->surface = gdk_wayland_window_get_wl_surface (gdk_window);
+  if (desktop->shell)
+    {
+      desktop_shell_set_user_data (desktop->shell, desktop);
+      desktop_shell_set_background (desktop->shell, output->output,
+	  background->surface);
+    }
+  else
+    {
+      weston_desktop_shell_set_user_data (desktop->wshell, desktop);
+      weston_desktop_shell_set_background (desktop->wshell, output->output,
+	  background->surface);
+    }
+
+  element_track_regions (background);
+
+  output->background = background;
+
+  gtk_widget_show_all (background->window);
+
+  maynard_trace_end (begin, "background_create");
+}
+
+/* the wallpaper is picked once the shell tells us the size. this is
+ * all that is needed to put the desktop on screen; the clock and the
+ * launcher grid follow with output_clock_create() and
+ * output_grid_create(). */
+static void
+output_create_elements (struct output *output)
+{
+  background_create (output);
+
+  /* panel needs to be first so the clock and launcher grid can
+   * be added to its layer */
+  panel_create (output);
+}
+
+/* made after the output was configured, the clock has to catch up
+ * with what shell_configure() did for the panel */
+static void
+output_clock_create (struct output *output)
+{
+  clock_create (output);
+
+  if (!output->configured)
+    return;
+
+  connect_enter_leave_signals (output, output->clock);
+  panel_reveal_on_edge (output, output->clock);
+  output_layout (output, output->width, output->height);
+
+  if (output->panel_state == PANEL_STATE_HIDING
+      || output->panel_state == PANEL_STATE_HIDDEN)
+    clock_slide_out (output);
+}
+
+static void
+output_grid_create (struct output *output)
+{
+  launcher_grid_create (output);
+
+  if (!output->configured)
+    return;
+
+  connect_enter_leave_signals (output, output->launcher_grid);
+  output_layout (output, output->width, output->height);
+}
+
+/* the slowest part of startup is making the launcher grids, which
+ * need the app index and every app's icon. so the desktop is put on
+ * screen first, and only once desktop_ready is sent do the clocks
+ * follow and then the grids, each in an idle slice of its own at a
+ * lower priority than drawing and input. */
+static gboolean
+startup_grids_idle_cb (gpointer data)
+{
+  struct desktop *desktop = data;
+  struct output *output;
+  gint64 begin;
+
+  wl_list_for_each (output, &desktop->outputs, link)
     {
-      weston_desktop_shell_set_user_data (desktop->wshell, desktop);
-      weston_desktop_shell_set_panel (desktop->wshell, desktop->output,
-          panel->surface);
-      weston_desktop_shell_set_panel_position (desktop->wshell,
-	  DESKTOP_SHELL_PANEL_POSITION_LEFT);
+      if (output->launcher_grid == NULL)
+        {
+          begin = maynard_trace_begin ();
+          output_grid_create (output);
+          maynard_trace_end (begin, "launcher grid");
+          return G_SOURCE_CONTINUE;
+        }
     }
-  shell_helper_set_panel (desktop->helper, panel->surface);
 
-  gtk_widget_show_all (panel->window);
+  maynard_trace_mark ("launcher grids");
+  desktop->grids_done = TRUE;
+  startup_report (desktop);
 
-  desktop->panel = panel;
+  return G_SOURCE_REMOVE;
 }
 
-/* Expose callback for the drawing area */
 static gboolean
-draw_cb (GtkWidget *widget,
-    cairo_t *cr,
-    gpointer data)
+startup_app_index_idle_cb (gpointer data)
 {
   struct desktop *desktop = data;
+  gint64 begin = maynard_trace_begin ();
 
-  gdk_cairo_set_source_pixbuf (cr, desktop->background->pixbuf, 0, 0);
-  cairo_paint (cr);
+  shell_app_system_get_default ();
+  maynard_trace_end (begin, "app index");
 
-  return TRUE;
-}
+  g_idle_add_full (G_PRIORITY_LOW, startup_grids_idle_cb, desktop, NULL);
 
-/* Destroy handler for the window */
-static void
-destroy_cb (GObject *object,
-    gpointer data)
-{
-  gtk_main_quit ();
+  return G_SOURCE_REMOVE;
 }
 
-static GdkPixbuf *
-scale_background (GdkPixbuf *original_pixbuf)
+static gboolean
+startup_clocks_idle_cb (gpointer data)
 {
-  /* Scale original_pixbuf so it mostly fits on the screen.
-   * If the aspect ratio is different than a bit on the right or on the
-   * bottom could be cropped out. */
-  GdkScreen *screen = gdk_screen_get_default ();
-  gint screen_width, screen_height;
-  gint original_width, original_height;
-  gint final_width, final_height;
-  gdouble ratio_horizontal, ratio_vertical, ratio;
+  struct desktop *desktop = data;
+  struct output *output;
+  gint64 begin = maynard_trace_begin ();
+
+  wl_list_for_each (output, &desktop->outputs, link)
+    {
+      if (output->clock == NULL)
+        output_clock_create (output);
+    }
 
-  screen_width = gdk_screen_get_width (screen);
-  screen_height = gdk_screen_get_height (screen);
-  original_width = gdk_pixbuf_get_width (original_pixbuf);
-  original_height = gdk_pixbuf_get_height (original_pixbuf);
+  maynard_trace_end (begin, "clocks");
 
-  ratio_horizontal = (double) screen_width / original_width;
-  ratio_vertical = (double) screen_height / original_height;
-  ratio = MAX (ratio_horizontal, ratio_vertical);
+  g_idle_add_full (G_PRIORITY_LOW, startup_app_index_idle_cb, desktop, NULL);
 
-  final_width = ceil (ratio * original_width);
-  final_height = ceil (ratio * original_height);
+  return G_SOURCE_REMOVE;
+}
+
+static void
+element_destroy (struct element *element)
+{
+  if (element == NULL)
+    return;
 
-  return gdk_pixbuf_scale_simple (original_pixbuf,
-      final_width, final_height, GDK_INTERP_BILINEAR);
+  gtk_widget_destroy (element->window);
+  if (element->image != NULL)
+    cairo_surface_destroy (element->image);
+  free (element);
 }
 
+/* the compositor destroys its views of our surfaces along with them,
+ * including any slide in progress */
 static void
-background_create (struct desktop *desktop)
+output_destroy (struct output *output)
 {
-  GdkWindow *gdk_window;
-  struct element *background;
-  const gchar *filename;
-  GdkPixbuf *unscaled_background;
-  const gchar *xpm_data[] = {"1 1 1 1", "_ c SteelBlue", "_"};
+  struct desktop *desktop = output->desktop;
 
-  background = malloc (sizeof *background);
-  memset (background, 0, sizeof *background);
+  if (output->panel_leave_idle_id > 0)
+    maynard_activity_idle_remove (maynard_activity_get_default (),
+        output->panel_leave_idle_id);
 
-  filename = g_getenv ("MAYNARD_BACKGROUND");
-  if (filename && filename[0] != '\0')
-    unscaled_background = gdk_pixbuf_new_from_file (filename, NULL);
-  else
-    unscaled_background = gdk_pixbuf_new_from_xpm_data (xpm_data);
+  /* don't leave the compositor waiting for an output which is gone */
+  if (desktop->ready_output == output)
+    desktop_send_ready (desktop);
 
-  if (!unscaled_background)
-    {
-      g_message ("Could not load background (%s).",
-          filename ? filename : "built-in");
-      exit (EXIT_FAILURE);
-    }
+  crossfade_finish (output);
 
-  background->pixbuf = scale_background (unscaled_background);
-  g_object_unref (unscaled_background);
+  if (output->wallpaper != NULL)
+    wallpaper_unref (output->wallpaper);
 
-  background->window = gtk_window_new (GTK_WINDOW_TOPLEVEL);
+  /* losing an output is not a reason to quit */
+  if (output->background != NULL)
+    g_signal_handlers_disconnect_by_func (output->background->window,
+        destroy_cb, NULL);
 
-  g_signal_connect (background->window, "destroy",
-      G_CALLBACK (destroy_cb), NULL);
+  /* the layer goes last */
+  element_destroy (output->launcher_grid);
+  element_destroy (output->clock);
+  element_destroy (output->panel);
+  element_destroy (output->background);
 
-  g_signal_connect (background->window, "draw",
-      G_CALLBACK (draw_cb), desktop);
+  wl_output_destroy (output->output);
+  wl_list_remove (&output->link);
+  free (output);
 
-  gtk_window_set_title (GTK_WINDOW (background->window), "maynard");
-  gtk_window_set_decorated (GTK_WINDOW (background->window), FALSE);
-  gtk_widget_realize (background->window);
+  curtain_update (desktop);
+}
 
-  gdk_window = gtk_widget_get_window (background->window);
-  gdk_wayland_window_set_use_custom_surface (gdk_window);
+/* the shell sends a new configure when the output changes size, but
+ * only while it still has our background; go by the output itself so
+ * nothing is left at the old size */
+static void
+output_changed (struct output *output)
+{
+  gint width = output->mode_width;
+  gint height = output->mode_height;
 
-  background->surface = gdk_wayland_window_get_wl_surface (gdk_window);
-  if (desktop->shell)
-    {
-      desktop_shell_set_user_data (desktop->shell, desktop);
-      desktop_shell_set_background (desktop->shell, desktop->output,
-	  background->surface);
-    }
-  else
+  if (!output->configured || width <= 0 || height <= 0)
+    return;
+
+  /* the odd transforms are the ones turning by 90 or 270 degrees */
+  if (output->transform & 1)
     {
-      weston_desktop_shell_set_user_data (desktop->wshell, desktop);
-      weston_desktop_shell_set_background (desktop->wshell, desktop->output,
-	  background->surface);
+      width = output->mode_height;
+      height = output->mode_width;
     }
 
-  desktop->background = background;
+  /* the mode is in pixels, the shell lays out in surface coordinates */
+  width /= output->scale;
+  height /= output->scale;
 
-  gtk_widget_show_all (background->window);
+  output_relayout (output, width, height);
 }
 
 static void
-curtain_create (struct desktop *desktop)
+output_handle_geometry (void *data,
+    struct wl_output *wl_output,
+    int32_t x,
+    int32_t y,
+    int32_t physical_width,
+    int32_t physical_height,
+    int32_t subpixel,
+    const char *make,
+    const char *model,
+    int32_t transform)
 {
-  GdkWindow *gdk_window;
-  struct element *curtain;
+  struct output *output = data;
+
+  output->x = x;
+  output->y = y;
+  output->transform = transform;
+
+  /* there is no done event to wait for */
+  if (wl_output_get_version (wl_output) < 2)
+    output_changed (output);
+}
 
-  curtain = malloc (sizeof *curtain);
-  memset (curtain, 0, sizeof *curtain);
+static void
+output_handle_mode (void *data,
+    struct wl_output *wl_output,
+    uint32_t flags,
+    int32_t width,
+    int32_t height,
+    int32_t refresh)
+{
+  struct output *output = data;
 
-  curtain->window = gtk_window_new (GTK_WINDOW_TOPLEVEL);
+  if (!(flags & WL_OUTPUT_MODE_CURRENT))
+    return;
 
-  gtk_window_set_title (GTK_WINDOW (curtain->window), "maynard");
-  gtk_window_set_decorated (GTK_WINDOW (curtain->window), FALSE);
-  gtk_widget_set_size_request (curtain->window, 8192, 8192);
-  gtk_widget_realize (curtain->window);
+  output->mode_width = width;
+  output->mode_height = height;
 
-  gdk_window = gtk_widget_get_window (curtain->window);
-  gdk_wayland_window_set_use_custom_surface (gdk_window);
+  if (wl_output_get_version (wl_output) < 2)
+    output_changed (output);
+}
 
-  curtain->surface = gdk_wayland_window_get_wl_surface (gdk_window);
+static void
+output_handle_done (void *data,
+    struct wl_output *wl_output)
+{
+  output_changed (data);
+}
 
-  desktop->curtain = curtain;
+static void
+output_handle_scale (void *data,
+    struct wl_output *wl_output,
+    int32_t factor)
+{
+  struct output *output = data;
 
-  gtk_widget_show_all (curtain->window);
+  output->scale = MAX (factor, 1);
 }
 
+static const struct wl_output_listener output_listener = {
+  output_handle_geometry,
+  output_handle_mode,
+  output_handle_done,
+  output_handle_scale
+};
+
 static void
 css_setup (struct desktop *desktop)
 {
@@ -712,17 +1970,18 @@ pointer_handle_button (void *data,
     uint32_t state_w)
 {
   struct desktop *desktop = data;
+  struct output *output;
 
   if (state_w != WL_POINTER_BUTTON_STATE_RELEASED)
     return;
 
-  if (!desktop->pointer_out_of_panel)
-    return;
-
-  if (desktop->grid_visible)
-    launcher_grid_toggle (desktop->launcher_grid->window, desktop);
-
-  panel_window_leave_cb (NULL, NULL, desktop);
+  /* only clicks on the background and the like; the panel and
+   * the grid handle their own */
+  wl_list_for_each (output, &desktop->outputs, link)
+    {
+      if (!output->pointer_in_panel && output->grid_visible)
+        panel_dismiss (output);
+    }
 }
 
 static void
@@ -742,6 +2001,83 @@ static const struct wl_pointer_listener pointer_listener = {
   pointer_handle_axis,
 };
 
+/* the grid or a swiped in panel is put away by touching anything but
+ * them, like clicking. the helper tells us about other clients'
+ * surfaces. */
+static void
+touch_dismiss (struct desktop *desktop)
+{
+  struct output *output;
+
+  wl_list_for_each (output, &desktop->outputs, link)
+    {
+      if (output->grid_visible || output->touch_shown)
+        panel_dismiss (output);
+    }
+}
+
+static void
+touch_handle_down (void *data,
+    struct wl_touch *touch,
+    uint32_t serial,
+    uint32_t time,
+    struct wl_surface *surface,
+    int32_t id,
+    wl_fixed_t x_w,
+    wl_fixed_t y_w)
+{
+  struct desktop *desktop = data;
+  struct output *output;
+
+  wl_list_for_each (output, &desktop->outputs, link)
+    {
+      if (output->background && surface == output->background->surface)
+        {
+          touch_dismiss (desktop);
+          return;
+        }
+    }
+}
+
+static void
+touch_handle_up (void *data,
+    struct wl_touch *touch,
+    uint32_t serial,
+    uint32_t time,
+    int32_t id)
+{
+}
+
+static void
+touch_handle_motion (void *data,
+    struct wl_touch *touch,
+    uint32_t time,
+    int32_t id,
+    wl_fixed_t x_w,
+    wl_fixed_t y_w)
+{
+}
+
+static void
+touch_handle_frame (void *data,
+    struct wl_touch *touch)
+{
+}
+
+static void
+touch_handle_cancel (void *data,
+    struct wl_touch *touch)
+{
+}
+
+static const struct wl_touch_listener touch_listener = {
+  touch_handle_down,
+  touch_handle_up,
+  touch_handle_motion,
+  touch_handle_frame,
+  touch_handle_cancel,
+};
+
 static void
 seat_handle_capabilities (void *data,
     struct wl_seat *seat,
@@ -759,7 +2095,15 @@ seat_handle_capabilities (void *data,
     desktop->pointer = NULL;
   }
 
-  /* TODO: keyboard and touch */
+  if ((caps & WL_SEAT_CAPABILITY_TOUCH) && !desktop->touch) {
+    desktop->touch = wl_seat_get_touch (seat);
+    wl_touch_add_listener (desktop->touch, &touch_listener, desktop);
+  } else if (!(caps & WL_SEAT_CAPABILITY_TOUCH) && desktop->touch) {
+    wl_touch_destroy (desktop->touch);
+    desktop->touch = NULL;
+  }
+
+  /* keys go to the focused surface through gtk's own seat */
 }
 
 static void
@@ -774,6 +2118,200 @@ static const struct wl_seat_listener seat_listener = {
   seat_handle_name
 };
 
+static void
+set_active (struct desktop *desktop,
+    gboolean active)
+{
+  struct output *output;
+
+  /* stops the revealer transitions as well */
+  g_object_set (gtk_settings_get_default (),
+      "gtk-enable-animations", active,
+      NULL);
+
+  maynard_activity_set_active (maynard_activity_get_default (), active);
+
+  if (!active)
+    return;
+
+  wl_list_for_each (output, &desktop->outputs, link)
+    {
+      if (output->background_dirty)
+        {
+          output->background_dirty = FALSE;
+          gtk_widget_queue_draw (output->background->window);
+        }
+    }
+}
+
+static void
+shell_helper_idle (void *data,
+    struct shell_helper *shell_helper)
+{
+  set_active (data, FALSE);
+}
+
+static void
+shell_helper_wake (void *data,
+    struct shell_helper *shell_helper)
+{
+  set_active (data, TRUE);
+}
+
+static void
+shell_helper_curtain_clicked (void *data,
+    struct shell_helper *shell_helper)
+{
+  struct desktop *desktop = data;
+  struct output *output;
+
+  /* same as clicking anywhere outside the panel */
+  wl_list_for_each (output, &desktop->outputs, link)
+    panel_dismiss (output);
+}
+
+static void
+shell_helper_slide_done (void *data,
+    struct shell_helper *shell_helper,
+    struct wl_surface *surface)
+{
+  struct desktop *desktop = data;
+  struct output *output;
+
+  wl_list_for_each (output, &desktop->outputs, link)
+    {
+      if (output->panel && surface == output->panel->surface)
+        panel_slide_done (output);
+    }
+}
+
+/* only sent by a version 6 helper, which cannot tell us where */
+static void
+shell_helper_edge_revealed (void *data,
+    struct shell_helper *shell_helper)
+{
+  struct desktop *desktop = data;
+  struct output *output;
+
+  wl_list_for_each (output, &desktop->outputs, link)
+    panel_edge_revealed (output, 0);
+}
+
+static void
+shell_helper_surface_revealed (void *data,
+    struct shell_helper *shell_helper,
+    struct wl_surface *surface)
+{
+  struct desktop *desktop = data;
+  struct output *output;
+  guint32 time = desktop->reveal_time;
+
+  /* it only goes with the event right after it */
+  desktop->reveal_time = 0;
+
+  wl_list_for_each (output, &desktop->outputs, link)
+    {
+      if (output->panel && surface == output->panel->surface)
+        panel_edge_revealed (output, time);
+    }
+}
+
+static void
+shell_helper_crossfade_finished (void *data,
+    struct shell_helper *shell_helper,
+    struct wl_surface *surface)
+{
+  struct desktop *desktop = data;
+  struct output *output;
+
+  wl_list_for_each (output, &desktop->outputs, link)
+    {
+      if (output->fade && surface == output->fade->surface)
+        crossfade_finish (output);
+    }
+}
+
+static void
+shell_helper_launcher_key (void *data,
+    struct shell_helper *shell_helper,
+    struct wl_output *wl_output)
+{
+  struct desktop *desktop = data;
+  struct output *output;
+
+  wl_list_for_each (output, &desktop->outputs, link)
+    {
+      if (output->output == wl_output)
+        break;
+    }
+
+  /* not one of ours; the first one will do */
+  if (&output->link == &desktop->outputs)
+    {
+      if (wl_list_empty (&desktop->outputs))
+        return;
+      output = wl_container_of (desktop->outputs.next, output, link);
+    }
+
+  if (output->configured)
+    launcher_grid_toggle (NULL, output);
+}
+
+/* the panel followed a finger in from the edge. nothing will leave
+ * it, so it stays until something dismisses it. */
+static void
+shell_helper_touch_revealed (void *data,
+    struct shell_helper *shell_helper,
+    struct wl_surface *surface)
+{
+  struct desktop *desktop = data;
+  struct output *output;
+  guint32 time = desktop->reveal_time;
+
+  desktop->reveal_time = 0;
+
+  wl_list_for_each (output, &desktop->outputs, link)
+    {
+      if (output->panel && surface == output->panel->surface)
+        {
+          output->touch_shown = TRUE;
+          panel_edge_revealed (output, time);
+        }
+    }
+}
+
+static void
+shell_helper_touch_elsewhere (void *data,
+    struct shell_helper *shell_helper)
+{
+  touch_dismiss (data);
+}
+
+/* comes right before surface_revealed or touch_revealed */
+static void
+shell_helper_reveal_time (void *data,
+    struct shell_helper *shell_helper,
+    uint32_t time)
+{
+  struct desktop *desktop = data;
+
+  desktop->reveal_time = time;
+}
+
+static const struct shell_helper_listener helper_listener = {
+  shell_helper_idle,
+  shell_helper_wake,
+  shell_helper_curtain_clicked,
+  shell_helper_crossfade_finished,
+  shell_helper_slide_done,
+  shell_helper_edge_revealed,
+  shell_helper_surface_revealed,
+  shell_helper_launcher_key,
+  shell_helper_touch_revealed,
+  shell_helper_touch_elsewhere,
+  shell_helper_reveal_time
+};
+
 static void
 registry_handle_global (void *data,
     struct wl_registry *registry,
@@ -797,11 +2335,33 @@ registry_handle_global (void *data,
       weston_desktop_shell_add_listener (d->wshell, &wshell_listener, d);
       weston_desktop_shell_set_user_data (d->wshell, d);
     }
+  else if (!strcmp (interface, "wl_compositor"))
+    {
+      d->compositor = wl_registry_bind (registry, name,
+          &wl_compositor_interface, 1);
+    }
   else if (!strcmp (interface, "wl_output"))
     {
-      /* TODO: create multiple outputs */
-      d->output = wl_registry_bind (registry, name,
-          &wl_output_interface, 1);
+      struct output *output;
+
+      output = malloc (sizeof *output);
+      memset (output, 0, sizeof *output);
+      output->desktop = d;
+      output->name = name;
+      output->scale = 1;
+      output->output = wl_registry_bind (registry, name,
+          &wl_output_interface, MIN(version, 2));
+      wl_output_add_listener (output->output, &output_listener, output);
+      output->panel_state = PANEL_STATE_SHOWN;
+      wl_list_insert (d->outputs.prev, &output->link);
+
+      /* plugged in while we are running */
+      if (d->started)
+        {
+          output_create_elements (output);
+          output_clock_create (output);
+          output_grid_create (output);
+        }
     }
   else if (!strcmp (interface, "wl_seat"))
     {
@@ -812,7 +2372,8 @@ registry_handle_global (void *data,
   else if (!strcmp (interface, "shell_helper"))
     {
       d->helper = wl_registry_bind (registry, name,
-          &shell_helper_interface, 1);
+          &shell_helper_interface, MIN(version, 12));
+      shell_helper_add_listener (d->helper, &helper_listener, d);
     }
 }
 
@@ -821,42 +2382,38 @@ registry_handle_global_remove (void *data,
     struct wl_registry *registry,
     uint32_t name)
 {
+  struct desktop *desktop = data;
+  struct output *output;
+
+  wl_list_for_each (output, &desktop->outputs, link)
+    {
+      if (output->name == name)
+        {
+          output_destroy (output);
+          return;
+        }
+    }
 }
 
+
 static const struct wl_registry_listener registry_listener = {
   registry_handle_global,
   registry_handle_global_remove
 };
 
-static void grab_surface_create(struct desktop *desktop)
+/* desktop-shell gives pointer focus to this surface during grabs so
+ * that we can set the cursor. nothing is ever drawn into it, so it
+ * never needs a buffer. */
+static void
+grab_surface_create (struct desktop *desktop)
 {
+  desktop->grab_surface = wl_compositor_create_surface (desktop->compositor);
 
-  struct wl_surface *s;
-
-  GdkWindow *gdk_window;
-  struct element *curtain;
-
-  curtain = malloc (sizeof *curtain);
-  memset (curtain, 0, sizeof *curtain);
-
-  curtain->window = gtk_window_new (GTK_WINDOW_TOPLEVEL);
-
-  gtk_window_set_title (GTK_WINDOW (curtain->window), "maynard2");
-  gtk_window_set_decorated (GTK_WINDOW (curtain->window), FALSE);
-  gtk_widget_set_size_request (curtain->window, 8192, 8192);
-  gtk_widget_realize (curtain->window);
-
-  gdk_window = gtk_widget_get_window (curtain->window);
-  gdk_wayland_window_set_use_custom_surface (gdk_window);
-
-  curtain->surface = gdk_wayland_window_get_wl_surface (gdk_window);
-
-  desktop->curtain = curtain;
-
-  gtk_widget_show_all (curtain->window);
-  weston_desktop_shell_set_grab_surface(desktop->wshell, curtain->surface);
-
-
+  if (desktop->shell)
+    desktop_shell_set_grab_surface (desktop->shell, desktop->grab_surface);
+  else
+    weston_desktop_shell_set_grab_surface (desktop->wshell,
+        desktop->grab_surface);
 }
 
 int
@@ -864,6 +2421,12 @@ main (int argc,
     char *argv[])
 {
   struct desktop *desktop;
+  struct output *output;
+  gint64 begin;
+
+  maynard_trace_init ();
+
+  begin = maynard_trace_begin ();
 
   gdk_set_allowed_backends ("wayland");
 
@@ -871,12 +2434,29 @@ main (int argc,
 
   g_resources_register (maynard_get_resource ());
 
+  maynard_trace_end (begin, "gtk_init");
+
   desktop = malloc (sizeof *desktop);
-  desktop->output = NULL;
+
+  desktop->compositor = NULL;
   desktop->shell = NULL;
+  desktop->wshell = NULL;
   desktop->helper = NULL;
   desktop->seat = NULL;
   desktop->pointer = NULL;
+  desktop->touch = NULL;
+  desktop->ready = FALSE;
+  desktop->grids_done = FALSE;
+  desktop->started = FALSE;
+  desktop->ready_output = NULL;
+  desktop->ready_paints = 0;
+  desktop->batch_depth = 0;
+  desktop->reveal_time = 0;
+  wl_list_init (&desktop->outputs);
+  wl_list_init (&desktop->wallpapers);
+
+  /* read once; moving the panel needs a restart */
+  desktop->edge = maynard_layout_get_edge ();
 
   desktop->gdk_display = gdk_display_get_default ();
   desktop->display =
@@ -887,38 +2467,44 @@ main (int argc,
       return -1;
     }
 
+  begin = maynard_trace_begin ();
+
   desktop->registry = wl_display_get_registry (desktop->display);
   wl_registry_add_listener (desktop->registry,
       &registry_listener, desktop);
 
   /* Wait until we have been notified about the compositor,
    * shell, and shell helper objects */
-  if (!desktop->output || (!desktop->shell && !desktop->wshell) ||
-      !desktop->helper)
+  if (!desktop->compositor || wl_list_empty (&desktop->outputs) ||
+      (!desktop->shell && !desktop->wshell) || !desktop->helper)
     wl_display_roundtrip (desktop->display);
-  if (!desktop->output || (!desktop->shell && !desktop->wshell) ||
-      !desktop->helper)
+  if (!desktop->compositor || wl_list_empty (&desktop->outputs) ||
+      (!desktop->shell && !desktop->wshell) || !desktop->helper)
     {
       fprintf (stderr, "could not find output, shell or helper modules\n");
       return -1;
     }
 
-  desktop->grid_visible = FALSE;
-  desktop->system_visible = FALSE;
-  desktop->volume_visible = FALSE;
-  desktop->pointer_out_of_panel = FALSE;
+  maynard_trace_end (begin, "registry");
+
+  desktop->settings = g_settings_new ("org.raspberrypi.maynard");
+  g_signal_connect (desktop->settings, "changed",
+      G_CALLBACK (animation_settings_changed_cb), desktop);
+  helper_set_animations (desktop);
 
+  begin = maynard_trace_begin ();
   css_setup (desktop);
-  background_create (desktop);
-  curtain_create (desktop);
+  maynard_trace_end (begin, "css");
+
+  begin = maynard_trace_begin ();
+  wl_list_for_each (output, &desktop->outputs, link)
+    output_create_elements (output);
+  maynard_trace_end (begin, "background and panel");
 
-  /* panel needs to be first so the clock and launcher grid can
-   * be added to its layer */
-  panel_create (desktop);
-  clock_create (desktop);
-  launcher_grid_create (desktop);
   grab_surface_create (desktop);
 
+  desktop->started = TRUE;
+
   gtk_main ();
 
   /* TODO cleanup */
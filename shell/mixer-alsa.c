@@ -0,0 +1,627 @@
+/*
+ * Copyright (C) 2014 Collabora Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ *
+ * Author: Jonny Lamb <jonny.lamb@collabora.co.uk>
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <alsa/asoundlib.h>
+#include <glib-unix.h>
+
+#include "mixer-backend.h"
+
+/* what we know about a sound card, so a hot-plug event only ever
+ * needs to look at the card which changed */
+typedef struct {
+  gint index;
+  gchar *name;
+  /* names of the simple elements with a playback volume */
+  gchar **elements;
+} AlsaCard;
+
+typedef struct {
+  MaynardMixerBackend parent;
+
+  /* element names to try, in order */
+  gchar **elements;
+
+  GMainContext *context;
+
+  /* gint index -> AlsaCard */
+  GHashTable *cards;
+  gint inotify_fd;
+  GSource *inotify_source;
+
+  /* the card we are bound to, or -1 for the "default" device */
+  gint card;
+  snd_mixer_t *handle;
+  snd_mixer_elem_t *elem;
+  glong min_volume, max_volume;
+  GSource *source;
+
+  MaynardMixerBackendNotify notify;
+  gpointer notify_data;
+} AlsaBackend;
+
+/* watches the mixer's poll descriptors so changes made by other
+ * programs are picked up without polling */
+typedef struct {
+  GSource source;
+  snd_mixer_t *handle;
+  GPollFD *fds;
+  gint n_fds;
+} MixerSource;
+
+static gdouble
+alsa_volume_to_percentage (AlsaBackend *backend,
+    glong value)
+{
+  glong range;
+
+  /* min volume isn't always zero unfortunately */
+  range = backend->max_volume - backend->min_volume;
+
+  value -= backend->min_volume;
+
+  return (value / (gdouble) range) * 100;
+}
+
+static glong
+percentage_to_alsa_volume (AlsaBackend *backend,
+    gdouble value)
+{
+  glong range;
+
+  /* min volume isn't always zero unfortunately */
+  range = backend->max_volume - backend->min_volume;
+
+  return (range * value / 100) + backend->min_volume;
+}
+
+static gboolean
+mixer_source_prepare (GSource *source,
+    gint *timeout)
+{
+  *timeout = -1;
+  return FALSE;
+}
+
+static gboolean
+mixer_source_check (GSource *source)
+{
+  MixerSource *mixer_source = (MixerSource *) source;
+  struct pollfd *pfds;
+  unsigned short revents = 0;
+  gint i;
+
+  pfds = g_newa (struct pollfd, mixer_source->n_fds);
+  for (i = 0; i < mixer_source->n_fds; i++)
+    {
+      pfds[i].fd = mixer_source->fds[i].fd;
+      pfds[i].events = mixer_source->fds[i].events;
+      pfds[i].revents = mixer_source->fds[i].revents;
+    }
+
+  snd_mixer_poll_descriptors_revents (mixer_source->handle,
+      pfds, mixer_source->n_fds, &revents);
+
+  return revents != 0;
+}
+
+static gboolean
+mixer_source_dispatch (GSource *source,
+    GSourceFunc callback,
+    gpointer user_data)
+{
+  MixerSource *mixer_source = (MixerSource *) source;
+
+  /* this ends up calling mixer_elem_cb for anything that changed. it
+   * fails once the card has gone away, in which case stop watching or
+   * we would spin on the hung up descriptors. */
+  if (snd_mixer_handle_events (mixer_source->handle) < 0)
+    return G_SOURCE_REMOVE;
+
+  return G_SOURCE_CONTINUE;
+}
+
+static void
+mixer_source_finalize (GSource *source)
+{
+  MixerSource *mixer_source = (MixerSource *) source;
+
+  g_free (mixer_source->fds);
+}
+
+static GSourceFuncs mixer_source_funcs = {
+  mixer_source_prepare,
+  mixer_source_check,
+  mixer_source_dispatch,
+  mixer_source_finalize
+};
+
+static GSource *
+mixer_source_new (snd_mixer_t *handle)
+{
+  GSource *source;
+  MixerSource *mixer_source;
+  struct pollfd *pfds;
+  gint i, n;
+
+  n = snd_mixer_poll_descriptors_count (handle);
+  if (n <= 0)
+    return NULL;
+
+  pfds = g_newa (struct pollfd, n);
+  n = snd_mixer_poll_descriptors (handle, pfds, n);
+  if (n <= 0)
+    return NULL;
+
+  source = g_source_new (&mixer_source_funcs, sizeof (MixerSource));
+  g_source_set_name (source, "maynard mixer");
+
+  mixer_source = (MixerSource *) source;
+  mixer_source->handle = handle;
+  mixer_source->n_fds = n;
+  mixer_source->fds = g_new0 (GPollFD, n);
+
+  for (i = 0; i < n; i++)
+    {
+      mixer_source->fds[i].fd = pfds[i].fd;
+      mixer_source->fds[i].events = pfds[i].events;
+      g_source_add_poll (source, &mixer_source->fds[i]);
+    }
+
+  return source;
+}
+
+static int
+mixer_elem_cb (snd_mixer_elem_t *elem,
+    unsigned int mask)
+{
+  AlsaBackend *backend = snd_mixer_elem_get_callback_private (elem);
+  glong volume;
+
+  if (mask == SND_CTL_EVENT_MASK_REMOVE)
+    {
+      backend->elem = NULL;
+      return 0;
+    }
+
+  if ((mask & SND_CTL_EVENT_MASK_VALUE) &&
+      snd_mixer_selem_get_playback_volume (elem,
+          SND_MIXER_SCHN_MONO, &volume) == 0)
+    {
+      backend->notify ((MaynardMixerBackend *) backend,
+          alsa_volume_to_percentage (backend, volume),
+          backend->notify_data);
+    }
+
+  return 0;
+}
+
+static void
+alsa_card_free (gpointer data)
+{
+  AlsaCard *card = data;
+
+  g_free (card->name);
+  g_strfreev (card->elements);
+  g_slice_free (AlsaCard, card);
+}
+
+/* opens the card's mixer once to find out what it can control */
+static AlsaCard *
+probe_card (gint index)
+{
+  AlsaCard *card;
+  snd_mixer_t *handle;
+  snd_mixer_elem_t *elem;
+  GPtrArray *elements;
+  gchar device[16];
+  gchar *name = NULL;
+
+  g_snprintf (device, sizeof device, "hw:%d", index);
+
+  if (snd_mixer_open (&handle, 0) < 0)
+    return NULL;
+
+  if (snd_mixer_attach (handle, device) < 0 ||
+      snd_mixer_selem_register (handle, NULL, NULL) < 0 ||
+      snd_mixer_load (handle) < 0)
+    {
+      snd_mixer_close (handle);
+      return NULL;
+    }
+
+  elements = g_ptr_array_new ();
+
+  for (elem = snd_mixer_first_elem (handle);
+       elem != NULL;
+       elem = snd_mixer_elem_next (elem))
+    {
+      if (snd_mixer_selem_is_active (elem) &&
+          snd_mixer_selem_has_playback_volume (elem))
+        g_ptr_array_add (elements, g_strdup (snd_mixer_selem_get_name (elem)));
+    }
+
+  g_ptr_array_add (elements, NULL);
+
+  snd_mixer_close (handle);
+
+  card = g_slice_new0 (AlsaCard);
+  card->index = index;
+  card->elements = (gchar **) g_ptr_array_free (elements, FALSE);
+
+  if (snd_card_get_name (index, &name) == 0)
+    {
+      card->name = g_strdup (name);
+      free (name);
+    }
+  else
+    {
+      card->name = g_strdup (device);
+    }
+
+  return card;
+}
+
+static void
+unbind_card (AlsaBackend *backend)
+{
+  if (backend->source != NULL)
+    {
+      g_source_destroy (backend->source);
+      g_source_unref (backend->source);
+      backend->source = NULL;
+    }
+
+  if (backend->handle != NULL)
+    snd_mixer_close (backend->handle);
+  backend->handle = NULL;
+  backend->elem = NULL;
+}
+
+static snd_mixer_elem_t *
+find_elem (AlsaBackend *backend,
+    const gchar * const *names)
+{
+  snd_mixer_selem_id_t *sid;
+  snd_mixer_elem_t *elem = NULL;
+  guint i;
+
+  if (names == NULL)
+    return NULL;
+
+  snd_mixer_selem_id_alloca (&sid);
+  snd_mixer_selem_id_set_index (sid, 0);
+
+  for (i = 0; names[i] != NULL && elem == NULL; i++)
+    {
+      snd_mixer_selem_id_set_name (sid, names[i]);
+      elem = snd_mixer_find_selem (backend->handle, sid);
+    }
+
+  return elem;
+}
+
+/* card is an index into the card cache, or -1 for "default" */
+static gboolean
+bind_card (AlsaBackend *backend,
+    gint card)
+{
+  AlsaCard *cached = NULL;
+  gchar device[16];
+  glong volume;
+  gint ret;
+
+  unbind_card (backend);
+
+  if (card < 0)
+    {
+      g_strlcpy (device, "default", sizeof device);
+    }
+  else
+    {
+      g_snprintf (device, sizeof device, "hw:%d", card);
+      cached = g_hash_table_lookup (backend->cards, GINT_TO_POINTER (card));
+    }
+
+  backend->card = card;
+
+  if ((ret = snd_mixer_open (&backend->handle, 0)) < 0)
+    goto error;
+
+  if ((ret = snd_mixer_attach (backend->handle, device)) < 0)
+    goto error;
+
+  if ((ret = snd_mixer_selem_register (backend->handle, NULL, NULL)) < 0)
+    goto error;
+
+  /* this is the call which can take a long time on some devices */
+  if ((ret = snd_mixer_load (backend->handle)) < 0)
+    goto error;
+
+  /* prefer the configured names, otherwise take whatever the card
+   * told us about when it was probed */
+  backend->elem = find_elem (backend,
+      (const gchar * const *) backend->elements);
+  if (backend->elem == NULL && cached != NULL)
+    backend->elem = find_elem (backend,
+        (const gchar * const *) cached->elements);
+
+  if (backend->elem == NULL)
+    {
+      ret = -ENOENT;
+      goto error;
+    }
+
+  if ((ret = snd_mixer_selem_get_playback_volume_range (backend->elem,
+              &backend->min_volume, &backend->max_volume)) < 0)
+    goto error;
+
+  /* listen for changes made by anyone else */
+  snd_mixer_elem_set_callback (backend->elem, mixer_elem_cb);
+  snd_mixer_elem_set_callback_private (backend->elem, backend);
+
+  backend->source = mixer_source_new (backend->handle);
+  if (backend->source != NULL)
+    g_source_attach (backend->source, backend->context);
+  else
+    g_debug ("mixer has no poll descriptors; external volume changes "
+        "will not be shown");
+
+  g_debug ("mixer bound to %s (%s)", device,
+      snd_mixer_selem_get_name (backend->elem));
+
+  if (snd_mixer_selem_get_playback_volume (backend->elem,
+          SND_MIXER_SCHN_MONO, &volume) == 0)
+    backend->notify ((MaynardMixerBackend *) backend,
+        alsa_volume_to_percentage (backend, volume),
+        backend->notify_data);
+
+  return TRUE;
+
+error:
+  g_debug ("failed to setup mixer on %s: %s", device, snd_strerror (ret));
+
+  unbind_card (backend);
+
+  return FALSE;
+}
+
+static void
+card_added (AlsaBackend *backend,
+    gint index)
+{
+  AlsaCard *card;
+
+  if (g_hash_table_contains (backend->cards, GINT_TO_POINTER (index)))
+    return;
+
+  /* this can fail until udev has fixed up the permissions, in which
+   * case we try again on the following IN_ATTRIB */
+  card = probe_card (index);
+  if (card == NULL)
+    return;
+
+  g_hash_table_insert (backend->cards, GINT_TO_POINTER (index), card);
+
+  g_debug ("sound card %d (%s) added", index, card->name);
+
+  /* a card which was just plugged in is most likely the one the user
+   * wants to hear */
+  if (card->elements[0] != NULL)
+    bind_card (backend, index);
+}
+
+static void
+card_removed (AlsaBackend *backend,
+    gint index)
+{
+  if (!g_hash_table_remove (backend->cards, GINT_TO_POINTER (index)))
+    return;
+
+  g_debug ("sound card %d removed", index);
+
+  /* we can't tell which card "default" was pointing at, so rebind it
+   * as well */
+  if (backend->card == index || backend->card < 0)
+    bind_card (backend, -1);
+}
+
+static gboolean
+inotify_cb (gint fd,
+    GIOCondition condition,
+    gpointer user_data)
+{
+  AlsaBackend *backend = user_data;
+  gchar buf[4096]
+    __attribute__ ((aligned (__alignof__ (struct inotify_event))));
+  const struct inotify_event *event;
+  gssize len;
+  gchar *ptr;
+  gint index;
+
+  while ((len = read (fd, buf, sizeof buf)) > 0)
+    {
+      for (ptr = buf; ptr < buf + len;
+           ptr += sizeof (struct inotify_event) + event->len)
+        {
+          event = (const struct inotify_event *) ptr;
+
+          if (event->len == 0 ||
+              sscanf (event->name, "controlC%d", &index) != 1)
+            continue;
+
+          if (event->mask & IN_DELETE)
+            card_removed (backend, index);
+          else
+            card_added (backend, index);
+        }
+    }
+
+  return G_SOURCE_CONTINUE;
+}
+
+static void
+watch_cards (AlsaBackend *backend)
+{
+  backend->inotify_fd = inotify_init1 (IN_NONBLOCK | IN_CLOEXEC);
+  if (backend->inotify_fd < 0)
+    {
+      g_debug ("failed to watch for sound cards: %s", g_strerror (errno));
+      return;
+    }
+
+  if (inotify_add_watch (backend->inotify_fd, "/dev/snd",
+          IN_CREATE | IN_DELETE | IN_ATTRIB) < 0)
+    {
+      g_debug ("failed to watch /dev/snd: %s", g_strerror (errno));
+      close (backend->inotify_fd);
+      backend->inotify_fd = -1;
+      return;
+    }
+
+  backend->inotify_source = g_unix_fd_source_new (backend->inotify_fd,
+      G_IO_IN);
+  g_source_set_callback (backend->inotify_source,
+      (GSourceFunc) inotify_cb, backend, NULL);
+  g_source_attach (backend->inotify_source, backend->context);
+}
+
+static void
+alsa_backend_close (MaynardMixerBackend *parent)
+{
+  AlsaBackend *backend = (AlsaBackend *) parent;
+
+  if (backend->inotify_source != NULL)
+    {
+      g_source_destroy (backend->inotify_source);
+      g_source_unref (backend->inotify_source);
+      backend->inotify_source = NULL;
+    }
+
+  if (backend->inotify_fd >= 0)
+    close (backend->inotify_fd);
+  backend->inotify_fd = -1;
+
+  unbind_card (backend);
+
+  g_hash_table_remove_all (backend->cards);
+}
+
+static gboolean
+alsa_backend_open (MaynardMixerBackend *parent,
+    GMainContext *context,
+    MaynardMixerBackendNotify notify,
+    gpointer user_data)
+{
+  AlsaBackend *backend = (AlsaBackend *) parent;
+  gint index = -1;
+
+  backend->context = context;
+  backend->notify = notify;
+  backend->notify_data = user_data;
+
+  /* start watching before enumerating so no card can slip through */
+  watch_cards (backend);
+
+  while (snd_card_next (&index) == 0 && index >= 0)
+    {
+      AlsaCard *card = probe_card (index);
+
+      if (card != NULL)
+        g_hash_table_insert (backend->cards, GINT_TO_POINTER (index), card);
+    }
+
+  /* even without a usable device now, one can still be plugged in
+   * later, so this never fails */
+  bind_card (backend, -1);
+
+  return TRUE;
+}
+
+static gboolean
+alsa_backend_get_volume (MaynardMixerBackend *parent,
+    gdouble *volume)
+{
+  AlsaBackend *backend = (AlsaBackend *) parent;
+  glong value;
+
+  if (backend->elem == NULL)
+    return FALSE;
+
+  if (snd_mixer_selem_get_playback_volume (backend->elem,
+          SND_MIXER_SCHN_MONO, &value) < 0)
+    return FALSE;
+
+  *volume = alsa_volume_to_percentage (backend, value);
+
+  return TRUE;
+}
+
+static void
+alsa_backend_set_volume (MaynardMixerBackend *parent,
+    gdouble volume)
+{
+  AlsaBackend *backend = (AlsaBackend *) parent;
+
+  if (backend->elem == NULL)
+    return;
+
+  snd_mixer_selem_set_playback_volume_all (backend->elem,
+      percentage_to_alsa_volume (backend, volume));
+}
+
+static void
+alsa_backend_free (MaynardMixerBackend *parent)
+{
+  AlsaBackend *backend = (AlsaBackend *) parent;
+
+  g_hash_table_destroy (backend->cards);
+  g_strfreev (backend->elements);
+
+  g_slice_free (AlsaBackend, backend);
+}
+
+MaynardMixerBackend *
+maynard_mixer_backend_alsa_new (const gchar * const *elements)
+{
+  AlsaBackend *backend;
+
+  backend = g_slice_new0 (AlsaBackend);
+  backend->parent.name = "alsa";
+  backend->parent.open = alsa_backend_open;
+  backend->parent.close = alsa_backend_close;
+  backend->parent.get_volume = alsa_backend_get_volume;
+  backend->parent.set_volume = alsa_backend_set_volume;
+  backend->parent.free = alsa_backend_free;
+
+  backend->elements = g_strdupv ((gchar **) elements);
+  backend->cards = g_hash_table_new_full (NULL, NULL, NULL, alsa_card_free);
+  backend->inotify_fd = -1;
+  backend->card = -1;
+
+  return (MaynardMixerBackend *) backend;
+}
@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2014 Collabora Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#ifndef __MAYNARD_MIXER_BACKEND_H__
+#define __MAYNARD_MIXER_BACKEND_H__
+
+#include <glib.h>
+
+typedef struct MaynardMixerBackend MaynardMixerBackend;
+
+/* called by a backend when the volume was changed by somebody else.
+ * volume is a percentage. */
+typedef void (*MaynardMixerBackendNotify) (MaynardMixerBackend *backend,
+    gdouble volume, gpointer user_data);
+
+/* every function here is only ever called from the mixer worker
+ * thread, so backends are free to block. */
+struct MaynardMixerBackend
+{
+  const gchar *name;
+
+  /* attach any event sources to context and call notify from them */
+  gboolean (*open) (MaynardMixerBackend *backend, GMainContext *context,
+      MaynardMixerBackendNotify notify, gpointer user_data);
+  void (*close) (MaynardMixerBackend *backend);
+
+  gboolean (*get_volume) (MaynardMixerBackend *backend, gdouble *volume);
+  void (*set_volume) (MaynardMixerBackend *backend, gdouble volume);
+
+  void (*free) (MaynardMixerBackend *backend);
+};
+
+MaynardMixerBackend * maynard_mixer_backend_alsa_new (
+    const gchar * const *elements);
+MaynardMixerBackend * maynard_mixer_backend_null_new (void);
+
+#endif /* __MAYNARD_MIXER_BACKEND_H__ */
@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2014 Collabora Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+
+#include "mixer-backend.h"
+
+/* a mixer which only remembers the volume. it is used when there is
+ * no sound hardware, and for measuring the slider without touching
+ * a real device: MAYNARD_MIXER_NULL_LATENCY (in milliseconds) makes
+ * every call block like a slow USB device would, and the number of
+ * writes is reported when the mixer is closed. */
+
+typedef struct {
+  MaynardMixerBackend parent;
+
+  gdouble volume;
+  gulong latency;
+
+  guint n_writes;
+  gint64 write_time;
+} NullBackend;
+
+static void
+null_backend_block (NullBackend *backend)
+{
+  if (backend->latency > 0)
+    g_usleep (backend->latency * 1000);
+}
+
+static gboolean
+null_backend_open (MaynardMixerBackend *parent,
+    GMainContext *context,
+    MaynardMixerBackendNotify notify,
+    gpointer user_data)
+{
+  NullBackend *backend = (NullBackend *) parent;
+
+  null_backend_block (backend);
+
+  return TRUE;
+}
+
+static void
+null_backend_close (MaynardMixerBackend *parent)
+{
+  NullBackend *backend = (NullBackend *) parent;
+
+  if (backend->n_writes > 0)
+    g_debug ("null mixer: %u writes, %" G_GINT64_FORMAT " us on average",
+        backend->n_writes, backend->write_time / backend->n_writes);
+}
+
+static gboolean
+null_backend_get_volume (MaynardMixerBackend *parent,
+    gdouble *volume)
+{
+  NullBackend *backend = (NullBackend *) parent;
+
+  null_backend_block (backend);
+  *volume = backend->volume;
+
+  return TRUE;
+}
+
+static void
+null_backend_set_volume (MaynardMixerBackend *parent,
+    gdouble volume)
+{
+  NullBackend *backend = (NullBackend *) parent;
+  gint64 start = g_get_monotonic_time ();
+
+  null_backend_block (backend);
+  backend->volume = volume;
+
+  backend->n_writes++;
+  backend->write_time += g_get_monotonic_time () - start;
+}
+
+static void
+null_backend_free (MaynardMixerBackend *parent)
+{
+  g_slice_free (NullBackend, (NullBackend *) parent);
+}
+
+MaynardMixerBackend *
+maynard_mixer_backend_null_new (void)
+{
+  NullBackend *backend;
+  const gchar *latency;
+
+  backend = g_slice_new0 (NullBackend);
+  backend->parent.name = "null";
+  backend->parent.open = null_backend_open;
+  backend->parent.close = null_backend_close;
+  backend->parent.get_volume = null_backend_get_volume;
+  backend->parent.set_volume = null_backend_set_volume;
+  backend->parent.free = null_backend_free;
+
+  backend->volume = 50;
+
+  latency = g_getenv ("MAYNARD_MIXER_NULL_LATENCY");
+  if (latency != NULL)
+    backend->latency = strtoul (latency, NULL, 10);
+
+  return (MaynardMixerBackend *) backend;
+}
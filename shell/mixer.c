@@ -0,0 +1,306 @@
+/*
+ * Copyright (C) 2014 Collabora Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#include "config.h"
+
+#include <gio/gio.h>
+
+#include "mixer.h"
+
+enum {
+  VOLUME_CHANGED,
+  N_SIGNALS
+};
+static guint signals[N_SIGNALS] = { 0 };
+
+/* all backend calls happen on a worker thread with its own main
+ * context, so a slow device never blocks the UI. results come back
+ * to the default main context as ::volume-changed. */
+struct MaynardMixerPrivate {
+  MaynardMixerBackend *backend;
+  gboolean opened; /* only touched by the worker */
+
+  GThread *thread;
+  GMainContext *context;
+  GMainLoop *loop;
+
+  gboolean notified; /* only touched by the worker */
+
+  GMutex lock;
+  /* protected by lock */
+  gboolean write_queued;
+  gdouble write_volume;
+  /* the same the other way round; the source holds no reference
+   * so dispose can drop it instead of it keeping us alive */
+  GSource *update_source;
+  gdouble update_volume;
+};
+
+G_DEFINE_TYPE(MaynardMixer, maynard_mixer, G_TYPE_OBJECT)
+
+static void
+maynard_mixer_init (MaynardMixer *self)
+{
+  self->priv = G_TYPE_INSTANCE_GET_PRIVATE (self,
+      MAYNARD_MIXER_TYPE,
+      MaynardMixerPrivate);
+
+  g_mutex_init (&self->priv->lock);
+}
+
+/* main thread */
+static gboolean
+volume_update_cb (gpointer data)
+{
+  MaynardMixer *self = data;
+  gdouble volume;
+
+  g_mutex_lock (&self->priv->lock);
+  volume = self->priv->update_volume;
+  g_source_unref (self->priv->update_source);
+  self->priv->update_source = NULL;
+  g_mutex_unlock (&self->priv->lock);
+
+  g_signal_emit (self, signals[VOLUME_CHANGED], 0, volume);
+
+  return G_SOURCE_REMOVE;
+}
+
+/* worker thread. only the latest value is emitted, however many
+ * came in before the main thread got round to it. */
+static void
+push_volume (MaynardMixer *self,
+    gdouble volume)
+{
+  g_mutex_lock (&self->priv->lock);
+
+  self->priv->update_volume = volume;
+
+  if (self->priv->update_source == NULL)
+    {
+      self->priv->update_source = g_idle_source_new ();
+      g_source_set_priority (self->priv->update_source,
+          G_PRIORITY_DEFAULT);
+      g_source_set_callback (self->priv->update_source,
+          volume_update_cb, self, NULL);
+      g_source_attach (self->priv->update_source, NULL);
+    }
+
+  g_mutex_unlock (&self->priv->lock);
+}
+
+static void
+backend_notify_cb (MaynardMixerBackend *backend,
+    gdouble volume,
+    gpointer user_data)
+{
+  MaynardMixer *self = MAYNARD_MIXER (user_data);
+
+  self->priv->notified = TRUE;
+  push_volume (self, volume);
+}
+
+static gboolean
+write_volume_cb (gpointer data)
+{
+  MaynardMixer *self = data;
+  gdouble volume;
+
+  /* only the latest value is written, however many were queued */
+  g_mutex_lock (&self->priv->lock);
+  volume = self->priv->write_volume;
+  self->priv->write_queued = FALSE;
+  g_mutex_unlock (&self->priv->lock);
+
+  if (self->priv->opened)
+    self->priv->backend->set_volume (self->priv->backend, volume);
+
+  return G_SOURCE_REMOVE;
+}
+
+static gboolean
+quit_cb (gpointer data)
+{
+  g_main_loop_quit (data);
+
+  return G_SOURCE_REMOVE;
+}
+
+static gpointer
+mixer_thread (gpointer data)
+{
+  MaynardMixer *self = data;
+  MaynardMixerBackend *backend = self->priv->backend;
+  gdouble volume;
+
+  g_main_context_push_thread_default (self->priv->context);
+
+  self->priv->opened = backend->open (backend, self->priv->context,
+      backend_notify_cb, self);
+
+  /* a backend which found a device has usually told us its volume
+   * already */
+  if (!self->priv->opened)
+    g_debug ("%s mixer backend not available", backend->name);
+  else if (!self->priv->notified && backend->get_volume (backend, &volume))
+    push_volume (self, volume);
+
+  g_main_loop_run (self->priv->loop);
+
+  if (self->priv->opened)
+    backend->close (backend);
+  self->priv->opened = FALSE;
+
+  g_main_context_pop_thread_default (self->priv->context);
+
+  return NULL;
+}
+
+static MaynardMixerBackend *
+create_backend (void)
+{
+  MaynardMixerBackend *backend;
+  GSettings *settings;
+  const gchar *name;
+  gchar *setting;
+  gchar **elements;
+
+  settings = g_settings_new ("org.raspberrypi.maynard");
+  setting = g_settings_get_string (settings, "mixer-backend");
+  elements = g_settings_get_strv (settings, "mixer-elements");
+
+  /* the environment wins so headless runs can pick the null mixer */
+  name = g_getenv ("MAYNARD_MIXER");
+  if (name == NULL || name[0] == '\0')
+    name = setting;
+
+  if (g_strcmp0 (name, "null") == 0)
+    {
+      backend = maynard_mixer_backend_null_new ();
+    }
+  else
+    {
+      if (g_strcmp0 (name, "alsa") != 0)
+        g_warning ("Unknown mixer backend '%s', using alsa", name);
+
+      backend = maynard_mixer_backend_alsa_new (
+          (const gchar * const *) elements);
+    }
+
+  g_strfreev (elements);
+  g_free (setting);
+  g_object_unref (settings);
+
+  return backend;
+}
+
+static void
+maynard_mixer_constructed (GObject *object)
+{
+  MaynardMixer *self = MAYNARD_MIXER (object);
+
+  G_OBJECT_CLASS (maynard_mixer_parent_class)->constructed (object);
+
+  self->priv->backend = create_backend ();
+
+  self->priv->context = g_main_context_new ();
+  self->priv->loop = g_main_loop_new (self->priv->context, FALSE);
+  self->priv->thread = g_thread_new ("maynard-mixer", mixer_thread, self);
+}
+
+static void
+maynard_mixer_dispose (GObject *object)
+{
+  MaynardMixer *self = MAYNARD_MIXER (object);
+
+  if (self->priv->thread != NULL)
+    {
+      /* queued after any pending write, so the last value still
+       * makes it to the device */
+      g_main_context_invoke (self->priv->context, quit_cb, self->priv->loop);
+      g_thread_join (self->priv->thread);
+      self->priv->thread = NULL;
+    }
+
+  /* nothing pushes any more; a volume nobody heard of yet goes too */
+  if (self->priv->update_source != NULL)
+    {
+      g_source_destroy (self->priv->update_source);
+      g_source_unref (self->priv->update_source);
+      self->priv->update_source = NULL;
+    }
+
+  G_OBJECT_CLASS (maynard_mixer_parent_class)->dispose (object);
+}
+
+static void
+maynard_mixer_finalize (GObject *object)
+{
+  MaynardMixer *self = MAYNARD_MIXER (object);
+
+  g_main_loop_unref (self->priv->loop);
+  g_main_context_unref (self->priv->context);
+
+  self->priv->backend->free (self->priv->backend);
+
+  g_mutex_clear (&self->priv->lock);
+
+  G_OBJECT_CLASS (maynard_mixer_parent_class)->finalize (object);
+}
+
+static void
+maynard_mixer_class_init (MaynardMixerClass *klass)
+{
+  GObjectClass *object_class = (GObjectClass *)klass;
+
+  object_class->constructed = maynard_mixer_constructed;
+  object_class->dispose = maynard_mixer_dispose;
+  object_class->finalize = maynard_mixer_finalize;
+
+  signals[VOLUME_CHANGED] = g_signal_new ("volume-changed",
+      G_TYPE_FROM_CLASS (klass), G_SIGNAL_RUN_LAST, 0, NULL, NULL,
+      NULL, G_TYPE_NONE, 1, G_TYPE_DOUBLE);
+
+  g_type_class_add_private (object_class, sizeof (MaynardMixerPrivate));
+}
+
+MaynardMixer *
+maynard_mixer_new (void)
+{
+  return g_object_new (MAYNARD_MIXER_TYPE,
+      NULL);
+}
+
+/* can be called as often as wanted; writes which have not reached the
+ * worker yet are replaced by the newer value. */
+void
+maynard_mixer_set_volume (MaynardMixer *self,
+    gdouble volume)
+{
+  gboolean queue;
+
+  g_mutex_lock (&self->priv->lock);
+  self->priv->write_volume = volume;
+  queue = !self->priv->write_queued;
+  self->priv->write_queued = TRUE;
+  g_mutex_unlock (&self->priv->lock);
+
+  if (queue)
+    g_main_context_invoke (self->priv->context, write_volume_cb, self);
+}
@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2014 Collabora Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#ifndef __MAYNARD_MIXER_H__
+#define __MAYNARD_MIXER_H__
+
+#include <glib-object.h>
+
+#include "mixer-backend.h"
+
+#define MAYNARD_MIXER_TYPE                 (maynard_mixer_get_type ())
+#define MAYNARD_MIXER(obj)                 (G_TYPE_CHECK_INSTANCE_CAST ((obj), MAYNARD_MIXER_TYPE, MaynardMixer))
+#define MAYNARD_MIXER_CLASS(klass)         (G_TYPE_CHECK_CLASS_CAST ((klass), MAYNARD_MIXER_TYPE, MaynardMixerClass))
+#define MAYNARD_IS_MIXER(obj)              (G_TYPE_CHECK_INSTANCE_TYPE ((obj), MAYNARD_MIXER_TYPE))
+#define MAYNARD_IS_MIXER_CLASS(klass)      (G_TYPE_CHECK_CLASS_TYPE ((klass), MAYNARD_MIXER_TYPE))
+#define MAYNARD_MIXER_GET_CLASS(obj)       (G_TYPE_INSTANCE_GET_CLASS ((obj), MAYNARD_MIXER_TYPE, MaynardMixerClass))
+
+typedef struct MaynardMixer MaynardMixer;
+typedef struct MaynardMixerClass MaynardMixerClass;
+typedef struct MaynardMixerPrivate MaynardMixerPrivate;
+
+struct MaynardMixer
+{
+  GObject parent;
+
+  MaynardMixerPrivate *priv;
+};
+
+struct MaynardMixerClass
+{
+  GObjectClass parent_class;
+};
+
+GType maynard_mixer_get_type (void) G_GNUC_CONST;
+
+MaynardMixer * maynard_mixer_new (void);
+
+void maynard_mixer_set_volume (MaynardMixer *self, gdouble volume);
+
+#endif /* __MAYNARD_MIXER_H__ */
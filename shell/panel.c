@@ -27,6 +27,11 @@
 #include "favorites.h"
 #include "vertical-clock.h"
 
+enum {
+  PROP_0,
+  PROP_EDGE,
+};
+
 enum {
   APP_MENU_TOGGLED,
   SYSTEM_TOGGLED,
@@ -37,6 +42,7 @@ enum {
 static guint signals[N_SIGNALS] = { 0 };
 
 struct MaynardPanelPrivate {
+  MaynardLayoutEdge edge;
   gboolean hidden;
 
   GtkWidget *revealer_buttons; /* for the top buttons */
@@ -107,10 +113,41 @@ favorite_launched_cb (MaynardFavorites *favorites,
   g_signal_emit (self, signals[FAVORITE_LAUNCHED], 0);
 }
 
+/* the buttons collapse towards the edge and the vertical clock grows
+ * out from it */
+static void
+get_transitions (MaynardLayoutEdge edge,
+    GtkRevealerTransitionType *buttons,
+    GtkRevealerTransitionType *clock)
+{
+  switch (edge)
+    {
+      case MAYNARD_LAYOUT_EDGE_RIGHT:
+        *buttons = GTK_REVEALER_TRANSITION_TYPE_SLIDE_RIGHT;
+        *clock = GTK_REVEALER_TRANSITION_TYPE_SLIDE_LEFT;
+        break;
+      case MAYNARD_LAYOUT_EDGE_TOP:
+        *buttons = GTK_REVEALER_TRANSITION_TYPE_SLIDE_UP;
+        *clock = GTK_REVEALER_TRANSITION_TYPE_SLIDE_DOWN;
+        break;
+      case MAYNARD_LAYOUT_EDGE_BOTTOM:
+        *buttons = GTK_REVEALER_TRANSITION_TYPE_SLIDE_DOWN;
+        *clock = GTK_REVEALER_TRANSITION_TYPE_SLIDE_UP;
+        break;
+      case MAYNARD_LAYOUT_EDGE_LEFT:
+      default:
+        *buttons = GTK_REVEALER_TRANSITION_TYPE_SLIDE_LEFT;
+        *clock = GTK_REVEALER_TRANSITION_TYPE_SLIDE_RIGHT;
+        break;
+    }
+}
+
 static void
 maynard_panel_constructed (GObject *object)
 {
   MaynardPanel *self = MAYNARD_PANEL (object);
+  GtkOrientation along, across;
+  GtkRevealerTransitionType buttons_transition, clock_transition;
   GtkWidget *main_box, *menu_box, *buttons_box;
   GtkWidget *ebox;
   GtkWidget *image;
@@ -129,12 +166,18 @@ maynard_panel_constructed (GObject *object)
       gtk_widget_get_style_context (GTK_WIDGET (self)),
       "maynard-panel");
 
-  /* main vbox */
-  main_box = gtk_box_new (GTK_ORIENTATION_VERTICAL, 0);
+  /* the panel runs along the edge, the menu box across it */
+  along = maynard_layout_get_orientation (self->priv->edge);
+  across = along == GTK_ORIENTATION_VERTICAL
+    ? GTK_ORIENTATION_HORIZONTAL : GTK_ORIENTATION_VERTICAL;
+  get_transitions (self->priv->edge, &buttons_transition, &clock_transition);
+
+  /* main box */
+  main_box = gtk_box_new (along, 0);
   gtk_container_add (GTK_CONTAINER (self), main_box);
 
   /* for the top buttons and vertical clock we have a few more
-   * boxes. the hbox has two cells. in each cell there is a
+   * boxes. the menu box has two cells. in each cell there is a
    * GtkRevealer for hiding and showing the content. only one revealer
    * is ever visibile at one point and transitions happen at the same
    * time so the width stays constant (the animation duration is the
@@ -149,20 +192,20 @@ maynard_panel_constructed (GObject *object)
   gtk_box_pack_start (GTK_BOX (main_box), ebox, FALSE, FALSE, 0);
   widget_connect_enter_signal (self, ebox);
 
-  menu_box = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 0);
+  menu_box = gtk_box_new (across, 0);
   gtk_container_add (GTK_CONTAINER (ebox), menu_box);
 
   /* revealer for the top buttons */
   self->priv->revealer_buttons = gtk_revealer_new ();
   gtk_revealer_set_transition_type (GTK_REVEALER (self->priv->revealer_buttons),
-      GTK_REVEALER_TRANSITION_TYPE_SLIDE_LEFT);
+      buttons_transition);
   gtk_revealer_set_reveal_child (GTK_REVEALER (self->priv->revealer_buttons),
       TRUE);
   gtk_box_pack_start (GTK_BOX (menu_box),
       self->priv->revealer_buttons, FALSE, FALSE, 0);
 
   /* the box for the top buttons */
-  buttons_box = gtk_box_new (GTK_ORIENTATION_VERTICAL, 0);
+  buttons_box = gtk_box_new (along, 0);
   gtk_container_add (GTK_CONTAINER (self->priv->revealer_buttons), buttons_box);
 
   /* system button */
@@ -202,7 +245,7 @@ maynard_panel_constructed (GObject *object)
   /* revealer for the vertical clock */
   self->priv->revealer_clock = gtk_revealer_new ();
   gtk_revealer_set_transition_type (GTK_REVEALER (self->priv->revealer_clock),
-      GTK_REVEALER_TRANSITION_TYPE_SLIDE_RIGHT);
+      clock_transition);
   gtk_revealer_set_reveal_child (GTK_REVEALER (self->priv->revealer_clock),
       FALSE);
   gtk_box_pack_start (GTK_BOX (menu_box),
@@ -210,7 +253,7 @@ maynard_panel_constructed (GObject *object)
 
   /* vertical clock */
   gtk_container_add (GTK_CONTAINER (self->priv->revealer_clock),
-      maynard_vertical_clock_new ());
+      maynard_vertical_clock_new (self->priv->edge));
 
   /* end of the menu buttons and vertical clock */
 
@@ -218,6 +261,7 @@ maynard_panel_constructed (GObject *object)
   ebox = gtk_event_box_new ();
   gtk_box_pack_start (GTK_BOX (main_box), ebox, FALSE, FALSE, 0);
   favorites = maynard_favorites_new ();
+  gtk_orientable_set_orientation (GTK_ORIENTABLE (favorites), along);
   gtk_container_add (GTK_CONTAINER (ebox), favorites);
   widget_connect_enter_signal (self, ebox);
 
@@ -249,6 +293,44 @@ maynard_panel_dispose (GObject *object)
   G_OBJECT_CLASS (maynard_panel_parent_class)->dispose (object);
 }
 
+static void
+maynard_panel_get_property (GObject *object,
+    guint param_id,
+    GValue *value,
+    GParamSpec *pspec)
+{
+  MaynardPanel *self = MAYNARD_PANEL (object);
+
+  switch (param_id)
+    {
+      case PROP_EDGE:
+        g_value_set_int (value, self->priv->edge);
+        break;
+      default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID (object, param_id, pspec);
+        break;
+    }
+}
+
+static void
+maynard_panel_set_property (GObject *object,
+    guint param_id,
+    const GValue *value,
+    GParamSpec *pspec)
+{
+  MaynardPanel *self = MAYNARD_PANEL (object);
+
+  switch (param_id)
+    {
+      case PROP_EDGE:
+        self->priv->edge = g_value_get_int (value);
+        break;
+      default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID (object, param_id, pspec);
+        break;
+    }
+}
+
 static void
 maynard_panel_class_init (MaynardPanelClass *klass)
 {
@@ -257,6 +339,16 @@ maynard_panel_class_init (MaynardPanelClass *klass)
 
   object_class->constructed = maynard_panel_constructed;
   object_class->dispose = maynard_panel_dispose;
+  object_class->get_property = maynard_panel_get_property;
+  object_class->set_property = maynard_panel_set_property;
+
+  g_object_class_install_property (object_class, PROP_EDGE,
+      g_param_spec_int ("edge",
+          "edge",
+          "The #MaynardLayoutEdge the panel is on",
+          MAYNARD_LAYOUT_EDGE_LEFT, MAYNARD_LAYOUT_EDGE_BOTTOM,
+          MAYNARD_LAYOUT_EDGE_LEFT,
+          G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY | G_PARAM_STATIC_STRINGS));
 
   signals[APP_MENU_TOGGLED] = g_signal_new ("app-menu-toggled",
       G_TYPE_FROM_CLASS (klass), G_SIGNAL_RUN_LAST, 0, NULL, NULL,
@@ -278,9 +370,10 @@ maynard_panel_class_init (MaynardPanelClass *klass)
 }
 
 GtkWidget *
-maynard_panel_new (void)
+maynard_panel_new (MaynardLayoutEdge edge)
 {
   return g_object_new (MAYNARD_PANEL_TYPE,
+      "edge", edge,
       NULL);
 }
 
@@ -332,6 +425,9 @@ void
 maynard_panel_set_volume_icon_name (MaynardPanel *self,
     const gchar *icon_name)
 {
+  if (g_strcmp0 (icon_name, self->priv->volume_icon_name) == 0)
+    return;
+
   g_free (self->priv->volume_icon_name);
   self->priv->volume_icon_name = g_strdup (icon_name);
 
@@ -24,6 +24,8 @@
 
 #include <gtk/gtk.h>
 
+#include "layout.h"
+
 #define MAYNARD_PANEL_TYPE                 (maynard_panel_get_type ())
 #define MAYNARD_PANEL(obj)                 (G_TYPE_CHECK_INSTANCE_CAST ((obj), MAYNARD_PANEL_TYPE, MaynardPanel))
 #define MAYNARD_PANEL_CLASS(klass)         (G_TYPE_CHECK_CLASS_CAST ((klass), MAYNARD_PANEL_TYPE, MaynardPanelClass))
@@ -47,6 +49,7 @@ struct MaynardPanelClass
   GtkWindowClass parent_class;
 };
 
+/* across and along the edge the panel is on */
 #define MAYNARD_PANEL_WIDTH 56
 #define MAYNARD_PANEL_HEIGHT_RATIO 0.73
 
@@ -58,7 +61,7 @@ typedef enum {
 
 GType maynard_panel_get_type (void) G_GNUC_CONST;
 
-GtkWidget * maynard_panel_new (void);
+GtkWidget * maynard_panel_new (MaynardLayoutEdge edge);
 
 void maynard_panel_set_expand (MaynardPanel *self, gboolean expand);
 
@@ -0,0 +1,178 @@
+/*
+ * Copyright (C) 2014 Collabora Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+/* times maynard_scaler_scale, and gdk-pixbuf's bilinear scaling which
+ * the wallpaper used before, over common photo and output sizes.
+ *
+ *   scaler-benchmark [ITERATIONS]
+ *
+ * every case is run ITERATIONS times (5 by default) and the fastest
+ * run is printed, in milliseconds. */
+
+#include "config.h"
+
+#include <stdlib.h>
+
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+#include "scaler.h"
+
+typedef struct {
+  gint width;
+  gint height;
+} Size;
+
+static const Size sources[] = {
+  { 1920, 1080 },
+  { 2592, 1944 },
+  { 3840, 2160 },
+  { 6000, 4000 },
+};
+
+static const Size outputs[] = {
+  { 800, 480 },
+  { 1280, 720 },
+  { 1920, 1080 },
+  { 2560, 1440 },
+};
+
+static const gchar *qualities[] = { "fast", "balanced", "best" };
+
+static void
+fill (guint8 *pixels,
+    gint width,
+    gint height)
+{
+  guint32 *p = (guint32 *) pixels;
+  gint x, y;
+
+  /* opaque gradients, so no filter can skip any work */
+  for (y = 0; y < height; y++)
+    for (x = 0; x < width; x++)
+      *p++ = 0xff000000 | ((x * 255 / width) << 16)
+          | ((y * 255 / height) << 8) | ((x ^ y) & 0xff);
+}
+
+static gdouble
+time_scaler (const guint8 *src,
+    const Size *source,
+    guint8 *dest,
+    const Size *output,
+    MaynardScalerQuality quality,
+    gint iterations)
+{
+  gint64 best = G_MAXINT64;
+  gint i;
+
+  for (i = 0; i < iterations; i++)
+    {
+      gint64 start = g_get_monotonic_time ();
+
+      maynard_scaler_scale (src, source->width, source->height,
+          source->width * 4, dest, output->width, output->height,
+          output->width * 4, quality);
+
+      best = MIN (best, g_get_monotonic_time () - start);
+    }
+
+  return best / 1000.0;
+}
+
+static gdouble
+time_pixbuf (GdkPixbuf *pixbuf,
+    const Size *output,
+    gint iterations)
+{
+  gint64 best = G_MAXINT64;
+  gint i;
+
+  for (i = 0; i < iterations; i++)
+    {
+      gint64 start = g_get_monotonic_time ();
+      GdkPixbuf *scaled;
+
+      scaled = gdk_pixbuf_scale_simple (pixbuf, output->width,
+          output->height, GDK_INTERP_BILINEAR);
+
+      best = MIN (best, g_get_monotonic_time () - start);
+      g_object_unref (scaled);
+    }
+
+  return best / 1000.0;
+}
+
+int
+main (int argc,
+    char *argv[])
+{
+  gint iterations = 5;
+  guint s, o, q;
+
+  if (argc > 2 || (argc == 2 && (iterations = atoi (argv[1])) < 1))
+    {
+      g_printerr ("usage: %s [ITERATIONS]\n", argv[0]);
+      return 1;
+    }
+
+  g_print ("%-11s %-11s %9s %9s %9s %9s\n", "source", "output",
+      qualities[0], qualities[1], qualities[2], "pixbuf");
+
+  for (s = 0; s < G_N_ELEMENTS (sources); s++)
+    {
+      const Size *source = &sources[s];
+      GdkPixbuf *pixbuf;
+      guint8 *src;
+
+      src = g_malloc ((gsize) source->width * source->height * 4);
+      fill (src, source->width, source->height);
+
+      /* the same bytes; the channel order does not matter for timing */
+      pixbuf = gdk_pixbuf_new_from_data (src, GDK_COLORSPACE_RGB, TRUE, 8,
+          source->width, source->height, source->width * 4, NULL, NULL);
+
+      for (o = 0; o < G_N_ELEMENTS (outputs); o++)
+        {
+          const Size *output = &outputs[o];
+          gchar *from, *to;
+          guint8 *dest;
+
+          if (output->width > source->width)
+            continue;
+
+          dest = g_malloc ((gsize) output->width * output->height * 4);
+          from = g_strdup_printf ("%dx%d", source->width, source->height);
+          to = g_strdup_printf ("%dx%d", output->width, output->height);
+
+          g_print ("%-11s %-11s", from, to);
+          for (q = 0; q < G_N_ELEMENTS (qualities); q++)
+            g_print (" %9.2f", time_scaler (src, source, dest, output, q,
+                    iterations));
+          g_print (" %9.2f\n", time_pixbuf (pixbuf, output, iterations));
+
+          g_free (from);
+          g_free (to);
+          g_free (dest);
+        }
+
+      g_object_unref (pixbuf);
+      g_free (src);
+    }
+
+  return 0;
+}
@@ -0,0 +1,592 @@
+/*
+ * Copyright (C) 2014 Collabora Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#include "config.h"
+
+#include <math.h>
+#include <string.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define HAVE_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define HAVE_SSE2 1
+#endif
+
+#include "scaler.h"
+
+/* scales 32-bit premultiplied pixels, as cairo stores them. large
+ * downscales are first halved with a 2x2 box filter, which is cheap,
+ * vectorised and does not alias, until the image is less than twice
+ * (four times for the best quality) the wanted size. the rest is done
+ * with nearest neighbour, bilinear or lanczos3 filtering.
+ *
+ * the box filter treats every byte the same, the other filters work
+ * on whole pixels with alpha in the top byte. the box and bilinear
+ * filters have NEON and SSE2 versions, which give exactly the same
+ * results as the plain C ones. */
+
+#define FIXED_SHIFT 14
+#define FIXED_ONE (1 << FIXED_SHIFT)
+
+typedef struct {
+  guint8 *data; /* NULL when borrowed from the caller */
+  const guint8 *pixels;
+  gint width;
+  gint height;
+  gint stride;
+} Image;
+
+static void
+box_halve_row_c (const guint8 *row0,
+    const guint8 *row1,
+    guint8 *dest,
+    gint x,
+    gint width)
+{
+  for (; x < width; x++)
+    {
+      const guint8 *a = row0 + 8 * x, *b = row1 + 8 * x;
+      guint8 *d = dest + 4 * x;
+      gint c;
+
+      for (c = 0; c < 4; c++)
+        d[c] = (a[c] + a[c + 4] + b[c] + b[c + 4] + 2) >> 2;
+    }
+}
+
+/* halves one row; width is the width of dest */
+static void
+box_halve_row (const guint8 *row0,
+    const guint8 *row1,
+    guint8 *dest,
+    gint width)
+{
+  gint x = 0;
+
+#if defined(HAVE_NEON)
+  for (; x + 4 <= width; x += 4)
+    {
+      /* deinterleave eight source pixels into even and odd ones */
+      uint32x4x2_t a = vld2q_u32 ((const uint32_t *) (row0 + 8 * x));
+      uint32x4x2_t b = vld2q_u32 ((const uint32_t *) (row1 + 8 * x));
+      uint8x16_t a0 = vreinterpretq_u8_u32 (a.val[0]);
+      uint8x16_t a1 = vreinterpretq_u8_u32 (a.val[1]);
+      uint8x16_t b0 = vreinterpretq_u8_u32 (b.val[0]);
+      uint8x16_t b1 = vreinterpretq_u8_u32 (b.val[1]);
+      uint16x8_t lo, hi;
+
+      /* sum all four in 16 bits, the rounding shift adds the 2 */
+      lo = vaddq_u16 (vaddl_u8 (vget_low_u8 (a0), vget_low_u8 (a1)),
+          vaddl_u8 (vget_low_u8 (b0), vget_low_u8 (b1)));
+      hi = vaddq_u16 (vaddl_u8 (vget_high_u8 (a0), vget_high_u8 (a1)),
+          vaddl_u8 (vget_high_u8 (b0), vget_high_u8 (b1)));
+
+      vst1q_u8 (dest + 4 * x,
+          vcombine_u8 (vrshrn_n_u16 (lo, 2), vrshrn_n_u16 (hi, 2)));
+    }
+#elif defined(HAVE_SSE2)
+  const __m128i zero = _mm_setzero_si128 ();
+  const __m128i two = _mm_set1_epi16 (2);
+
+  for (; x + 4 <= width; x += 4)
+    {
+      __m128i a0 = _mm_loadu_si128 ((const __m128i *) (row0 + 8 * x));
+      __m128i a1 = _mm_loadu_si128 ((const __m128i *) (row0 + 8 * x + 16));
+      __m128i b0 = _mm_loadu_si128 ((const __m128i *) (row1 + 8 * x));
+      __m128i b1 = _mm_loadu_si128 ((const __m128i *) (row1 + 8 * x + 16));
+      __m128i s0, s1, s2, s3, lo, hi;
+
+      /* columns summed in 16 bits, two source pixels per register */
+      s0 = _mm_add_epi16 (_mm_unpacklo_epi8 (a0, zero),
+          _mm_unpacklo_epi8 (b0, zero));
+      s1 = _mm_add_epi16 (_mm_unpackhi_epi8 (a0, zero),
+          _mm_unpackhi_epi8 (b0, zero));
+      s2 = _mm_add_epi16 (_mm_unpacklo_epi8 (a1, zero),
+          _mm_unpacklo_epi8 (b1, zero));
+      s3 = _mm_add_epi16 (_mm_unpackhi_epi8 (a1, zero),
+          _mm_unpackhi_epi8 (b1, zero));
+
+      /* then even and odd pixels added together */
+      lo = _mm_add_epi16 (_mm_unpacklo_epi64 (s0, s1),
+          _mm_unpackhi_epi64 (s0, s1));
+      hi = _mm_add_epi16 (_mm_unpacklo_epi64 (s2, s3),
+          _mm_unpackhi_epi64 (s2, s3));
+
+      lo = _mm_srli_epi16 (_mm_add_epi16 (lo, two), 2);
+      hi = _mm_srli_epi16 (_mm_add_epi16 (hi, two), 2);
+
+      _mm_storeu_si128 ((__m128i *) (dest + 4 * x),
+          _mm_packus_epi16 (lo, hi));
+    }
+#endif
+
+  box_halve_row_c (row0, row1, dest, x, width);
+}
+
+static void
+box_halve (Image *image)
+{
+  gint width = image->width / 2, height = image->height / 2;
+  gint stride = width * 4;
+  guint8 *data;
+  gint y;
+
+  data = g_malloc (stride * height);
+
+  for (y = 0; y < height; y++)
+    box_halve_row (image->pixels + 2 * y * image->stride,
+        image->pixels + (2 * y + 1) * image->stride,
+        data + y * stride, width);
+
+  g_free (image->data);
+  image->data = data;
+  image->pixels = data;
+  image->width = width;
+  image->height = height;
+  image->stride = stride;
+}
+
+static void
+scale_nearest (const Image *src,
+    guint8 *dest,
+    gint dest_width,
+    gint dest_height,
+    gint dest_stride)
+{
+  gint *columns;
+  gint x, y;
+
+  columns = g_new (gint, dest_width);
+  for (x = 0; x < dest_width; x++)
+    columns[x] = MIN ((gint) ((x + 0.5) * src->width / dest_width),
+        src->width - 1);
+
+  for (y = 0; y < dest_height; y++)
+    {
+      gint sy = MIN ((gint) ((y + 0.5) * src->height / dest_height),
+          src->height - 1);
+      const guint32 *row = (const guint32 *) (src->pixels + sy * src->stride);
+      guint32 *d = (guint32 *) (dest + y * dest_stride);
+
+      for (x = 0; x < dest_width; x++)
+        d[x] = row[columns[x]];
+    }
+
+  g_free (columns);
+}
+
+/* position of the first source pixel and the 8-bit weight of the
+ * second one, sampling at pixel centres */
+static void
+bilinear_setup (gint src_size,
+    gint dest_size,
+    gint *first,
+    gint *weight)
+{
+  gint i;
+
+  for (i = 0; i < dest_size; i++)
+    {
+      gdouble pos = (i + 0.5) * src_size / dest_size - 0.5;
+      gint p = floor (pos);
+
+      weight[i] = (gint) ((pos - p) * 256);
+      if (p < 0)
+        {
+          p = 0;
+          weight[i] = 0;
+        }
+      else if (p >= src_size - 1)
+        {
+          p = src_size - 1;
+          weight[i] = 0;
+        }
+      first[i] = p;
+    }
+}
+
+static void
+bilinear_row_c (const guint32 *row0,
+    const guint32 *row1,
+    const gint *xs,
+    const gint *xw,
+    gint fy,
+    guint32 *dest,
+    gint x,
+    gint width)
+{
+  for (; x < width; x++)
+    {
+      gint fx = xw[x], x0 = xs[x], x1 = fx > 0 ? x0 + 1 : x0;
+      guint32 p00 = row0[x0], p01 = row0[x1];
+      guint32 p10 = row1[x0], p11 = row1[x1];
+      guint32 w00 = (256 - fx) * (256 - fy), w01 = fx * (256 - fy);
+      guint32 w10 = (256 - fx) * fy, w11 = fx * fy;
+      guint32 pixel = 0;
+      gint shift;
+
+      for (shift = 0; shift < 32; shift += 8)
+        {
+          guint32 c;
+
+          c = ((p00 >> shift) & 0xff) * w00
+            + ((p01 >> shift) & 0xff) * w01
+            + ((p10 >> shift) & 0xff) * w10
+            + ((p11 >> shift) & 0xff) * w11;
+          pixel |= ((c + 0x8000) >> 16) << shift;
+        }
+
+      dest[x] = pixel;
+    }
+}
+
+/* the vector versions blend each row horizontally first, which fits
+ * in 16 bits, then the two rows in 32 bits. the sum is the same as
+ * the one above, so the results are too. */
+static void
+bilinear_row (const guint32 *row0,
+    const guint32 *row1,
+    const gint *xs,
+    const gint *xw,
+    gint fy,
+    guint32 *dest,
+    gint width)
+{
+  gint x = 0;
+
+#if defined(HAVE_NEON)
+  const uint16x4_t wy0 = vdup_n_u16 (256 - fy), wy1 = vdup_n_u16 (fy);
+
+  for (; x + 2 <= width; x += 2)
+    {
+      gint a = xs[x], b = xs[x + 1];
+      gint a1 = xw[x] > 0 ? a + 1 : a, b1 = xw[x + 1] > 0 ? b + 1 : b;
+      uint32x2_t p00 = { row0[a], row0[b] }, p01 = { row0[a1], row0[b1] };
+      uint32x2_t p10 = { row1[a], row1[b] }, p11 = { row1[a1], row1[b1] };
+      uint16x8_t wx1 = vcombine_u16 (vdup_n_u16 (xw[x]),
+          vdup_n_u16 (xw[x + 1]));
+      uint16x8_t wx0 = vsubq_u16 (vdupq_n_u16 (256), wx1);
+      uint16x8_t h0, h1;
+      uint32x4_t lo, hi;
+
+      h0 = vmlaq_u16 (vmulq_u16 (vmovl_u8 (vreinterpret_u8_u32 (p00)), wx0),
+          vmovl_u8 (vreinterpret_u8_u32 (p01)), wx1);
+      h1 = vmlaq_u16 (vmulq_u16 (vmovl_u8 (vreinterpret_u8_u32 (p10)), wx0),
+          vmovl_u8 (vreinterpret_u8_u32 (p11)), wx1);
+
+      lo = vmlal_u16 (vmull_u16 (vget_low_u16 (h0), wy0),
+          vget_low_u16 (h1), wy1);
+      hi = vmlal_u16 (vmull_u16 (vget_high_u16 (h0), wy0),
+          vget_high_u16 (h1), wy1);
+
+      /* the rounding shift adds the 0x8000 */
+      vst1_u32 (dest + x, vreinterpret_u32_u8 (vmovn_u16 (vcombine_u16 (
+                      vrshrn_n_u32 (lo, 16), vrshrn_n_u32 (hi, 16)))));
+    }
+#elif defined(HAVE_SSE2)
+  const __m128i zero = _mm_setzero_si128 ();
+  const __m128i round = _mm_set1_epi32 (0x8000);
+  const __m128i wy0 = _mm_set1_epi16 (256 - fy), wy1 = _mm_set1_epi16 (fy);
+
+  for (; x + 2 <= width; x += 2)
+    {
+      gint a = xs[x], b = xs[x + 1];
+      gint a1 = xw[x] > 0 ? a + 1 : a, b1 = xw[x + 1] > 0 ? b + 1 : b;
+      __m128i p00, p01, p10, p11, wx0, wx1, h0, h1, m0, m1, lo, hi;
+
+      p00 = _mm_unpacklo_epi8 (_mm_set_epi32 (0, 0, row0[b], row0[a]), zero);
+      p01 = _mm_unpacklo_epi8 (_mm_set_epi32 (0, 0, row0[b1], row0[a1]),
+          zero);
+      p10 = _mm_unpacklo_epi8 (_mm_set_epi32 (0, 0, row1[b], row1[a]), zero);
+      p11 = _mm_unpacklo_epi8 (_mm_set_epi32 (0, 0, row1[b1], row1[a1]),
+          zero);
+
+      wx1 = _mm_set_epi16 (xw[x + 1], xw[x + 1], xw[x + 1], xw[x + 1],
+          xw[x], xw[x], xw[x], xw[x]);
+      wx0 = _mm_sub_epi16 (_mm_set1_epi16 (256), wx1);
+
+      /* at most 255 * 256, which still fits unsigned */
+      h0 = _mm_add_epi16 (_mm_mullo_epi16 (p00, wx0),
+          _mm_mullo_epi16 (p01, wx1));
+      h1 = _mm_add_epi16 (_mm_mullo_epi16 (p10, wx0),
+          _mm_mullo_epi16 (p11, wx1));
+
+      /* full 32 bit products from their low and high halves */
+      m0 = _mm_mullo_epi16 (h0, wy0);
+      m1 = _mm_mulhi_epu16 (h0, wy0);
+      lo = _mm_unpacklo_epi16 (m0, m1);
+      hi = _mm_unpackhi_epi16 (m0, m1);
+      m0 = _mm_mullo_epi16 (h1, wy1);
+      m1 = _mm_mulhi_epu16 (h1, wy1);
+      lo = _mm_add_epi32 (lo, _mm_unpacklo_epi16 (m0, m1));
+      hi = _mm_add_epi32 (hi, _mm_unpackhi_epi16 (m0, m1));
+
+      lo = _mm_srli_epi32 (_mm_add_epi32 (lo, round), 16);
+      hi = _mm_srli_epi32 (_mm_add_epi32 (hi, round), 16);
+
+      lo = _mm_packs_epi32 (lo, hi);
+      _mm_storel_epi64 ((__m128i *) (dest + x), _mm_packus_epi16 (lo, lo));
+    }
+#endif
+
+  bilinear_row_c (row0, row1, xs, xw, fy, dest, x, width);
+}
+
+static void
+scale_bilinear (const Image *src,
+    guint8 *dest,
+    gint dest_width,
+    gint dest_height,
+    gint dest_stride)
+{
+  gint *xs, *xw, *ys, *yw;
+  gint y;
+
+  xs = g_new (gint, dest_width);
+  xw = g_new (gint, dest_width);
+  ys = g_new (gint, dest_height);
+  yw = g_new (gint, dest_height);
+
+  bilinear_setup (src->width, dest_width, xs, xw);
+  bilinear_setup (src->height, dest_height, ys, yw);
+
+  for (y = 0; y < dest_height; y++)
+    {
+      const guint32 *row0, *row1;
+      gint fy = yw[y];
+
+      row0 = (const guint32 *) (src->pixels + ys[y] * src->stride);
+      row1 = fy > 0 ?
+          (const guint32 *) (src->pixels + (ys[y] + 1) * src->stride) : row0;
+
+      bilinear_row (row0, row1, xs, xw, fy,
+          (guint32 *) (dest + y * dest_stride), dest_width);
+    }
+
+  g_free (xs);
+  g_free (xw);
+  g_free (ys);
+  g_free (yw);
+}
+
+static gdouble
+lanczos3 (gdouble x)
+{
+  if (x == 0.0)
+    return 1.0;
+  if (x <= -3.0 || x >= 3.0)
+    return 0.0;
+
+  x *= G_PI;
+  return 3.0 * sin (x) * sin (x / 3.0) / (x * x);
+}
+
+/* fixed point weights for n_taps source pixels starting at first[i]
+ * for every destination pixel. when shrinking, the filter is
+ * stretched so it covers all the source pixels. */
+static gint32 *
+lanczos_setup (gint src_size,
+    gint dest_size,
+    gint *first,
+    gint *n_taps)
+{
+  gdouble scale = (gdouble) src_size / dest_size;
+  gdouble filter_scale = MAX (scale, 1.0);
+  gdouble support = 3.0 * filter_scale;
+  gint32 *weights;
+  gdouble *w;
+  gint taps, i, j;
+
+  taps = (gint) ceil (support) * 2 + 1;
+  weights = g_new (gint32, dest_size * taps);
+  w = g_new (gdouble, taps);
+
+  for (i = 0; i < dest_size; i++)
+    {
+      gdouble center = (i + 0.5) * scale;
+      gdouble sum = 0;
+      gint32 total = 0, *fixed = weights + i * taps;
+      gint peak = 0;
+
+      first[i] = (gint) floor (center - support);
+
+      for (j = 0; j < taps; j++)
+        {
+          w[j] = lanczos3 ((first[i] + j + 0.5 - center) / filter_scale);
+          sum += w[j];
+        }
+
+      for (j = 0; j < taps; j++)
+        {
+          fixed[j] = (gint32) floor (w[j] / sum * FIXED_ONE + 0.5);
+          total += fixed[j];
+          if (fixed[j] > fixed[peak])
+            peak = j;
+        }
+
+      /* rounding must not change the brightness */
+      fixed[peak] += FIXED_ONE - total;
+    }
+
+  g_free (w);
+
+  *n_taps = taps;
+  return weights;
+}
+
+static inline guint32
+clamp_channel (gint64 value)
+{
+  value = (value + (FIXED_ONE / 2)) >> FIXED_SHIFT;
+  return CLAMP (value, 0, 255);
+}
+
+static void
+scale_lanczos (const Image *src,
+    guint8 *dest,
+    gint dest_width,
+    gint dest_height,
+    gint dest_stride)
+{
+  gint32 *xw, *yw;
+  gint *xs, *ys;
+  gint x_taps, y_taps;
+  guint32 *tmp;
+  gint x, y, j;
+
+  xs = g_new (gint, dest_width);
+  ys = g_new (gint, dest_height);
+  xw = lanczos_setup (src->width, dest_width, xs, &x_taps);
+  yw = lanczos_setup (src->height, dest_height, ys, &y_taps);
+
+  /* horizontal pass into dest_width x src->height */
+  tmp = g_new (guint32, dest_width * src->height);
+
+  for (y = 0; y < src->height; y++)
+    {
+      const guint32 *row = (const guint32 *) (src->pixels + y * src->stride);
+      guint32 *t = tmp + y * dest_width;
+
+      for (x = 0; x < dest_width; x++)
+        {
+          const gint32 *w = xw + x * x_taps;
+          gint64 acc[4] = { 0, 0, 0, 0 };
+          gint c;
+
+          for (j = 0; j < x_taps; j++)
+            {
+              gint sx = CLAMP (xs[x] + j, 0, src->width - 1);
+              guint32 p = row[sx];
+
+              for (c = 0; c < 4; c++)
+                acc[c] += (gint64) ((p >> (8 * c)) & 0xff) * w[j];
+            }
+
+          t[x] = 0;
+          for (c = 0; c < 4; c++)
+            t[x] |= clamp_channel (acc[c]) << (8 * c);
+        }
+    }
+
+  /* vertical pass into dest */
+  for (y = 0; y < dest_height; y++)
+    {
+      const gint32 *w = yw + y * y_taps;
+      guint32 *d = (guint32 *) (dest + y * dest_stride);
+
+      for (x = 0; x < dest_width; x++)
+        {
+          gint64 acc[4] = { 0, 0, 0, 0 };
+          guint32 alpha, pixel = 0;
+          gint c;
+
+          for (j = 0; j < y_taps; j++)
+            {
+              gint sy = CLAMP (ys[y] + j, 0, src->height - 1);
+              guint32 p = tmp[sy * dest_width + x];
+
+              for (c = 0; c < 4; c++)
+                acc[c] += (gint64) ((p >> (8 * c)) & 0xff) * w[j];
+            }
+
+          /* ringing must not leave a colour brighter than its alpha,
+           * which premultiplied data cannot represent */
+          alpha = clamp_channel (acc[3]);
+          for (c = 0; c < 3; c++)
+            pixel |= MIN (clamp_channel (acc[c]), alpha) << (8 * c);
+
+          d[x] = pixel | (alpha << 24);
+        }
+    }
+
+  g_free (tmp);
+  g_free (xs);
+  g_free (ys);
+  g_free (xw);
+  g_free (yw);
+}
+
+void
+maynard_scaler_scale (const guint8 *src,
+    gint src_width,
+    gint src_height,
+    gint src_stride,
+    guint8 *dest,
+    gint dest_width,
+    gint dest_height,
+    gint dest_stride,
+    MaynardScalerQuality quality)
+{
+  Image image = { NULL, src, src_width, src_height, src_stride };
+  /* lanczos is good at shrinking by itself, leave it more to do */
+  gint box_limit = quality == MAYNARD_SCALER_BEST ? 4 : 2;
+  gint y;
+
+  while (image.width >= dest_width * box_limit
+      && image.height >= dest_height * box_limit)
+    box_halve (&image);
+
+  if (image.width == dest_width && image.height == dest_height)
+    {
+      for (y = 0; y < dest_height; y++)
+        memcpy (dest + y * dest_stride, image.pixels + y * image.stride,
+            dest_width * 4);
+    }
+  else
+    {
+      switch (quality)
+        {
+          case MAYNARD_SCALER_FAST:
+            scale_nearest (&image, dest, dest_width, dest_height, dest_stride);
+            break;
+          case MAYNARD_SCALER_BALANCED:
+            scale_bilinear (&image, dest, dest_width, dest_height,
+                dest_stride);
+            break;
+          case MAYNARD_SCALER_BEST:
+          default:
+            scale_lanczos (&image, dest, dest_width, dest_height, dest_stride);
+            break;
+        }
+    }
+
+  g_free (image.data);
+}
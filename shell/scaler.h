@@ -0,0 +1,38 @@
+/*
+ * Copyright (C) 2014 Collabora Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#ifndef __MAYNARD_SCALER_H__
+#define __MAYNARD_SCALER_H__
+
+#include <glib.h>
+
+/* keep in sync with the WallpaperQuality enum in the gschema */
+typedef enum {
+  MAYNARD_SCALER_FAST,
+  MAYNARD_SCALER_BALANCED,
+  MAYNARD_SCALER_BEST
+} MaynardScalerQuality;
+
+void maynard_scaler_scale (const guint8 *src,
+    gint src_width, gint src_height, gint src_stride,
+    guint8 *dest,
+    gint dest_width, gint dest_height, gint dest_stride,
+    MaynardScalerQuality quality);
+
+#endif /* __MAYNARD_SCALER_H__ */
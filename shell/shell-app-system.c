@@ -7,6 +7,8 @@
 
 #include <gio/gio.h>
 
+#include "trace.h"
+
 enum {
   INSTALLED_CHANGED,
   LAST_SIGNAL
@@ -46,6 +48,7 @@ static void
 shell_app_system_init (ShellAppSystem *self)
 {
   ShellAppSystemPrivate *priv;
+  gint64 begin = maynard_trace_begin ();
 
   self->priv = priv = G_TYPE_INSTANCE_GET_PRIVATE (self,
                                                    SHELL_TYPE_APP_SYSTEM,
@@ -59,6 +62,8 @@ shell_app_system_init (ShellAppSystem *self)
   g_signal_connect (priv->apps_tree, "changed", G_CALLBACK (on_apps_tree_changed_cb), self);
 
   on_apps_tree_changed_cb (priv->apps_tree, self);
+
+  maynard_trace_end (begin, "shell_app_system_init");
 }
 
 static void
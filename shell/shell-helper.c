@@ -21,6 +21,10 @@
 
 #include <stdio.h>
 #include <assert.h>
+#include <math.h>
+#include <time.h>
+#include <linux/input.h>
+#include <glib.h>
 
 #include "config.h"
 #ifdef HAVE_NEW_WESTON
@@ -30,6 +34,7 @@
 #endif
 
 #include "shell-helper-server-protocol.h"
+#include "velocity.h"
 
 #ifndef container_of
 #define container_of(ptr, type, member) ({                              \
@@ -37,21 +42,372 @@
         (type *)( (char *)__mptr - offsetof(type,member) );})
 #endif
 
+#ifndef MIN
+#define MIN(x,y) (((x) < (y)) ? (x) : (y))
+#endif
+
+#define SHELL_HELPER_VERSION 12
+
+/* a value moving to a target over time, along a curve. it is driven
+ * by the repaints of one output and goes by their timestamps, so a
+ * slow output shows fewer steps of the same movement rather than a
+ * slower one, and the last frame always has the target. */
+struct anim_style {
+	uint32_t curve; /* enum shell_helper_curve */
+	uint32_t duration; /* ms, for going all the way */
+};
+
+struct anim;
+
+typedef void (*anim_frame_func_t)(struct anim *anim, double value);
+typedef void (*anim_done_func_t)(struct anim *anim);
+
+struct anim {
+	double span; /* all the way, which takes style.duration */
+	double from, to, value;
+	double speed; /* per ms, only for springs */
+	uint32_t duration; /* of this run, for the eased curves */
+	uint32_t start_msecs, last_msecs;
+	struct anim_style style;
+	int running;
+
+	anim_frame_func_t frame;
+	anim_done_func_t done;
+
+	struct weston_output *output;
+	struct weston_animation animation;
+	struct wl_listener output_destroy_listener;
+};
+
+/* springs are stepped in at most this many ms, so they stay stable
+ * however long a frame took */
+#define ANIM_STEP_MS 4.0
+
+/* (1 + wt) e^-wt, how far a critically damped spring still has to go,
+ * is down to 0.2% when wt is this */
+#define ANIM_SPRING_SETTLE 8.4
+
+static void
+anim_init(struct anim *anim, double span,
+	  anim_frame_func_t frame, anim_done_func_t done)
+{
+	memset(anim, 0, sizeof *anim);
+	anim->span = span;
+	anim->frame = frame;
+	anim->done = done;
+	wl_list_init(&anim->animation.link);
+	wl_list_init(&anim->output_destroy_listener.link);
+}
+
+/* stop where it is, without calling back */
+static void
+anim_stop(struct anim *anim)
+{
+	wl_list_remove(&anim->animation.link);
+	wl_list_init(&anim->animation.link);
+	wl_list_remove(&anim->output_destroy_listener.link);
+	wl_list_init(&anim->output_destroy_listener.link);
+	anim->running = 0;
+	anim->speed = 0.0;
+}
+
+/* jump to the end; done may start the animation again */
+static void
+anim_finish(struct anim *anim)
+{
+	anim_stop(anim);
+	anim->value = anim->to;
+	anim->frame(anim, anim->value);
+	anim->done(anim);
+}
+
+static double
+anim_ease(uint32_t curve, double t)
+{
+	switch (curve) {
+	case SHELL_HELPER_CURVE_EASE_OUT:
+		return 1.0 - (1.0 - t) * (1.0 - t) * (1.0 - t);
+	case SHELL_HELPER_CURVE_EASE_IN_OUT:
+		if (t < 0.5)
+			return 4.0 * t * t * t;
+		return 1.0 - 4.0 * (1.0 - t) * (1.0 - t) * (1.0 - t);
+	case SHELL_HELPER_CURVE_LINEAR:
+	default:
+		return t;
+	}
+}
+
+/* whether it came to rest */
+static int
+anim_spring_step(struct anim *anim, uint32_t elapsed)
+{
+	double omega = ANIM_SPRING_SETTLE / anim->style.duration;
+	double step = MIN(ANIM_STEP_MS, 0.5 / omega);
+	double left = elapsed, h, accel;
+
+	while (left > 0.0) {
+		h = MIN(left, step);
+		accel = -2.0 * omega * anim->speed -
+			omega * omega * (anim->value - anim->to);
+		anim->speed += accel * h;
+		anim->value += anim->speed * h;
+		left -= h;
+	}
+
+	/* a spring turned around keeps its speed and may overshoot */
+	if (anim->value < 0.0)
+		anim->value = 0.0;
+	if (anim->value > anim->span)
+		anim->value = anim->span;
+
+	return fabs(anim->value - anim->to) < 0.002 * anim->span &&
+		fabs(anim->speed) * anim->style.duration < 0.01 * anim->span;
+}
+
+static void
+anim_frame(struct weston_animation *animation,
+	   struct weston_output *output, uint32_t msecs)
+{
+	struct anim *anim = container_of(animation, struct anim, animation);
+	uint32_t elapsed;
+	double t;
+
+	/* the first repaint after starting is time zero */
+	if (animation->frame_counter <= 1)
+		anim->start_msecs = anim->last_msecs = msecs;
+
+	elapsed = msecs - anim->last_msecs;
+	anim->last_msecs = msecs;
+
+	if (anim->style.curve == SHELL_HELPER_CURVE_SPRING) {
+		/* however wobbly, it ends in time */
+		if (anim_spring_step(anim, elapsed) ||
+		    msecs - anim->start_msecs >= 2 * anim->style.duration) {
+			anim_finish(anim);
+			return;
+		}
+	} else {
+		t = (double) (msecs - anim->start_msecs) / anim->duration;
+		if (t >= 1.0) {
+			anim_finish(anim);
+			return;
+		}
+
+		anim->value = anim->from +
+			(anim->to - anim->from) * anim_ease(anim->style.curve, t);
+	}
+
+	anim->frame(anim, anim->value);
+}
+
+static void
+anim_output_destroyed(struct wl_listener *listener, void *data)
+{
+	struct anim *anim =
+		container_of(listener, struct anim, output_destroy_listener);
+
+	anim_finish(anim);
+}
+
+/* head for to from wherever it is now, even in the middle of another
+ * run. the eased curves take the part of the duration that the
+ * distance is of span; a spring keeps its speed. */
+static void
+anim_run(struct anim *anim, struct weston_output *output,
+	 const struct anim_style *style, double to)
+{
+	double speed = anim->running ? anim->speed : 0.0;
+
+	anim_stop(anim);
+
+	anim->style = *style;
+	anim->from = anim->value;
+	anim->to = to;
+	anim->speed = speed;
+	anim->duration = style->duration * fabs(to - anim->from) / anim->span;
+
+	/* nowhere to show it, or nothing to show */
+	if (!output || anim->duration == 0 || style->duration == 0) {
+		anim_finish(anim);
+		return;
+	}
+
+	anim->running = 1;
+	anim->output = output;
+	anim->output_destroy_listener.notify = anim_output_destroyed;
+	wl_signal_add(&output->destroy_signal,
+		      &anim->output_destroy_listener);
+
+	anim->animation.frame_counter = 0;
+	anim->animation.frame = anim_frame;
+	wl_list_insert(&output->animation_list, &anim->animation.link);
+
+	anim->frame(anim, anim->value);
+	weston_output_schedule_repaint(output);
+}
+
 struct shell_helper {
 	struct weston_compositor *compositor;
 
 	struct wl_listener destroy_listener;
+	struct wl_listener idle_listener;
+	struct wl_listener wake_listener;
+
+	struct wl_list resource_list;
 
 	struct weston_layer *panel_layer;
 
 	struct weston_layer curtain_layer;
+	struct weston_surface *curtain_surface; /* only if we created it */
 	struct weston_view *curtain_view;
-	struct weston_view_animation *curtain_animation;
+	struct anim curtain_anim; /* of the alpha, up to 0.7 */
+	struct wl_listener curtain_view_destroy_listener;
 	uint32_t curtain_show;
 
+	/* set_animation */
+	struct anim_style slide_style;
+	struct anim_style curtain_style;
+
+	/* every surface slid out or on its way: looked up by
+	 * weston_surface in slides, walked with slide_list. finished
+	 * slides wait in slide_pool to be used again. */
+	GHashTable *slides;
 	struct wl_list slide_list;
+	struct wl_list slide_pool;
+
+	struct wl_list edge_list;
+	struct wl_listener seat_created_listener;
+
+	struct wl_list batch_list;
+
+	struct swipe *swipe; /* at most one at a time */
+};
+
+/* the requests a client sent between begin_batch and commit_batch,
+ * applied together so that their animations start on the same
+ * repaint */
+enum batch_op_type {
+	BATCH_OP_MOVE,
+	BATCH_OP_SLIDE,
+	BATCH_OP_SLIDE_BACK,
+	BATCH_OP_CURTAIN
+};
+
+struct batch_op {
+	enum batch_op_type type;
+	struct weston_surface *surface; /* may be NULL for the curtain */
+	int32_t x, y; /* y is unused for the curtain, x is show */
+
+	struct wl_listener surface_destroy_listener;
+	struct wl_list link;
+};
+
+struct batch {
+	struct wl_resource *resource;
+	struct wl_list op_list;
+	struct wl_list link;
 };
 
+static struct batch *
+batch_find(struct wl_resource *resource)
+{
+	struct shell_helper *helper = wl_resource_get_user_data(resource);
+	struct batch *batch;
+
+	wl_list_for_each(batch, &helper->batch_list, link) {
+		if (batch->resource == resource)
+			return batch;
+	}
+
+	return NULL;
+}
+
+static void
+batch_op_destroy(struct batch_op *op)
+{
+	wl_list_remove(&op->surface_destroy_listener.link);
+	wl_list_remove(&op->link);
+	free(op);
+}
+
+static void
+batch_op_surface_destroyed(struct wl_listener *listener, void *data)
+{
+	struct batch_op *op =
+		container_of(listener, struct batch_op,
+			     surface_destroy_listener);
+
+	/* the curtain can do without its surface, nothing else can */
+	if (op->type != BATCH_OP_CURTAIN) {
+		batch_op_destroy(op);
+		return;
+	}
+
+	wl_list_remove(&op->surface_destroy_listener.link);
+	wl_list_init(&op->surface_destroy_listener.link);
+	op->surface = NULL;
+}
+
+/* whether the request was queued rather than to be carried out now */
+static int
+batch_queue(struct wl_resource *resource, enum batch_op_type type,
+	    struct weston_surface *surface, int32_t x, int32_t y)
+{
+	struct batch *batch = batch_find(resource);
+	struct batch_op *op;
+
+	if (!batch)
+		return 0;
+
+	op = zalloc(sizeof *op);
+	if (!op) {
+		wl_resource_post_no_memory(resource);
+		return 1;
+	}
+
+	op->type = type;
+	op->surface = surface;
+	op->x = x;
+	op->y = y;
+
+	wl_list_init(&op->surface_destroy_listener.link);
+	if (surface) {
+		op->surface_destroy_listener.notify =
+			batch_op_surface_destroyed;
+		wl_signal_add(&surface->destroy_signal,
+			      &op->surface_destroy_listener);
+	}
+
+	wl_list_insert(batch->op_list.prev, &op->link);
+
+	return 1;
+}
+
+static void
+batch_destroy(struct batch *batch)
+{
+	while (!wl_list_empty(&batch->op_list))
+		batch_op_destroy(container_of(batch->op_list.next,
+					      struct batch_op, link));
+
+	wl_list_remove(&batch->link);
+	free(batch);
+}
+
+static void
+move_surface(struct weston_surface *surface, int32_t x, int32_t y)
+{
+	struct weston_view *view;
+
+	view = container_of(surface->views.next, struct weston_view, surface_link);
+
+	if (!view)
+		return;
+
+	weston_view_set_position(view, x, y);
+	weston_view_update_transform(view);
+}
+
 static void
 shell_helper_move_surface(struct wl_client *client,
 			  struct wl_resource *resource,
@@ -59,18 +415,13 @@ shell_helper_move_surface(struct wl_client *client,
 			  int32_t x,
 			  int32_t y)
 {
-	struct shell_helper *helper = wl_resource_get_user_data(resource);
 	struct weston_surface *surface =
 		wl_resource_get_user_data(surface_resource);
-	struct weston_view *view;
 
-	view = container_of(surface->views.next, struct weston_view, surface_link);
-
-	if (!view)
+	if (batch_queue(resource, BATCH_OP_MOVE, surface, x, y))
 		return;
 
-	weston_view_set_position(view, x, y);
-	weston_view_update_transform(view);
+	move_surface(surface, x, y);
 }
 
 static void
@@ -200,7 +551,8 @@ enum SlideState {
 	SLIDE_STATE_SLIDING_OUT,
 	SLIDE_STATE_OUT,
 	SLIDE_STATE_SLIDING_BACK,
-	SLIDE_STATE_BACK
+	SLIDE_STATE_BACK,
+	SLIDE_STATE_DRAGGED /* by a finger, see struct swipe */
 };
 
 enum SlideRequest {
@@ -210,118 +562,217 @@ enum SlideRequest {
 };
 
 struct slide {
+	struct shell_helper *helper;
 	struct weston_surface *surface;
 	struct weston_view *view;
 	int x;
 	int y;
 
 	enum SlideState state;
-	enum SlideRequest request;
+	enum SlideRequest request; /* only while DRAGGED */
 
+	/* from 0, where the surface is, to 1, all the way out. the
+	 * transform stays on the view for as long as the slide lives */
+	struct anim anim;
 	struct weston_transform transform;
 
+	struct wl_listener surface_destroy_listener;
 	struct wl_list link;
 };
 
-static void slide_back(struct slide *slide);
+/* the panel and the clock are slid out and back every time they are
+ * revealed, so their slides are kept rather than handed back to
+ * malloc each time */
+static struct slide *
+slide_alloc(struct shell_helper *helper)
+{
+	struct slide *slide;
+
+	if (wl_list_empty(&helper->slide_pool))
+		return malloc(sizeof *slide);
+
+	slide = container_of(helper->slide_pool.next, struct slide, link);
+	wl_list_remove(&slide->link);
+
+	return slide;
+}
+
+static void
+slide_release(struct slide *slide)
+{
+	wl_list_insert(&slide->helper->slide_pool, &slide->link);
+}
 
+/* the slide no longer belongs to its surface */
 static void
-slide_done_cb(struct weston_view_animation *animation, void *data)
+slide_unlink(struct slide *slide)
 {
-	struct slide *slide = data;
+	wl_list_remove(&slide->surface_destroy_listener.link);
+	wl_list_remove(&slide->link);
+	g_hash_table_remove(slide->helper->slides, slide->surface);
+}
 
-	slide->state = SLIDE_STATE_OUT;
+static void
+slide_surface_destroyed(struct wl_listener *listener, void *data)
+{
+	struct slide *slide =
+		container_of(listener, struct slide, surface_destroy_listener);
 
-	wl_list_insert(&slide->view->transform.position.link,
-		       &slide->transform.link);
-	weston_matrix_init(&slide->transform.matrix);
-	weston_matrix_translate(&slide->transform.matrix,
-				slide->x,
-				slide->y,
-				0);
+	slide_unlink(slide);
+	anim_stop(&slide->anim);
+	wl_list_remove(&slide->transform.link);
+	slide_release(slide);
+}
 
-	weston_view_geometry_dirty(slide->view);
-	weston_compositor_schedule_repaint(slide->surface->compositor);
+static void
+send_slide_done(struct shell_helper *helper, struct weston_surface *surface)
+{
+	struct wl_resource *resource;
 
-	if (slide->request == SLIDE_REQUEST_BACK) {
-		slide->request = SLIDE_REQUEST_NONE;
-		slide_back(slide);
+	wl_resource_for_each(resource, &helper->resource_list) {
+		if (wl_resource_get_version(resource) >= 5 &&
+		    wl_resource_get_client(resource) ==
+		    wl_resource_get_client(surface->resource))
+			shell_helper_send_slide_done(resource,
+						     surface->resource);
 	}
 }
 
 static void
-slide_out(struct slide *slide)
+slide_send_done(struct slide *slide)
 {
-	assert(slide->state == SLIDE_STATE_NONE || slide->state == SLIDE_STATE_BACK);
+	send_slide_done(slide->helper, slide->surface);
+}
 
-	slide->state = SLIDE_STATE_SLIDING_OUT;
+static void
+slide_anim_frame(struct anim *anim, double offset)
+{
+	struct slide *slide = container_of(anim, struct slide, anim);
+
+	weston_matrix_init(&slide->transform.matrix);
+	weston_matrix_translate(&slide->transform.matrix,
+				slide->x * offset,
+				slide->y * offset,
+				0);
 
-	weston_move_scale_run(slide->view, slide->x, slide->y,
-			      1.0, 1.0, 0,
-			      slide_done_cb, slide);
+	weston_view_geometry_dirty(slide->view);
+	weston_view_schedule_repaint(slide->view);
 }
 
+/* for whoever moves the slide without its animation */
 static void
-slide_back_done_cb(struct weston_view_animation *animation, void *data)
+slide_set_offset(struct slide *slide, double offset)
 {
-	struct slide *slide = data;
+	slide->anim.value = offset;
+	slide_anim_frame(&slide->anim, offset);
+}
 
+static void
+slide_arrived_back(struct slide *slide)
+{
 	slide->state = SLIDE_STATE_BACK;
 
 	wl_list_remove(&slide->transform.link);
 	weston_view_geometry_dirty(slide->view);
 
-	if (slide->request == SLIDE_REQUEST_OUT) {
-		slide->request = SLIDE_REQUEST_NONE;
-		slide_out(slide);
+	slide_send_done(slide);
+	slide_unlink(slide);
+	slide_release(slide);
+}
+
+static void
+slide_anim_done(struct anim *anim)
+{
+	struct slide *slide = container_of(anim, struct slide, anim);
+
+	if (slide->state == SLIDE_STATE_SLIDING_OUT) {
+		slide->state = SLIDE_STATE_OUT;
+		slide_send_done(slide);
 	} else {
-		wl_list_remove(&slide->link);
-		free(slide);
+		slide_arrived_back(slide);
+	}
+}
+
+/* the output the surface rests on. view->output follows the slide's
+ * transform, so a surface slid out of one output is counted on its
+ * neighbour, or on whichever output comes last when it is on none. */
+static struct weston_output *
+slide_output(struct slide *slide)
+{
+	struct weston_output *output;
+	int32_t x = slide->view->geometry.x + slide->surface->width / 2;
+	int32_t y = slide->view->geometry.y + slide->surface->height / 2;
+
+	wl_list_for_each(output, &slide->helper->compositor->output_list,
+			 link) {
+		if (pixman_region32_contains_point(&output->region, x, y,
+						   NULL))
+			return output;
 	}
+
+	return slide->view->output;
 }
 
+/* both ways start from wherever the slide is, so asking for the
+ * other way while it moves just turns it around */
 static void
-slide_back(struct slide *slide)
+slide_out(struct slide *slide)
 {
-	assert(slide->state == SLIDE_STATE_OUT);
+	slide->state = SLIDE_STATE_SLIDING_OUT;
+
+	anim_run(&slide->anim, slide_output(slide),
+		 &slide->helper->slide_style, 1.0);
+}
 
+static void
+slide_back(struct slide *slide)
+{
 	slide->state = SLIDE_STATE_SLIDING_BACK;
 
-	weston_move_scale_run(slide->view, -slide->x, -slide->y,
-			      1.0, 1.0, 0,
-			      slide_back_done_cb, slide);
+	anim_run(&slide->anim, slide_output(slide),
+		 &slide->helper->slide_style, 0.0);
+}
+
+static struct slide *
+slide_find(struct shell_helper *helper, struct weston_surface *surface)
+{
+	return g_hash_table_lookup(helper->slides, surface);
 }
 
 static void
-shell_helper_slide_surface(struct wl_client *client,
-			   struct wl_resource *resource,
-			   struct wl_resource *surface_resource,
-			   int32_t x,
-			   int32_t y)
+slide_surface(struct shell_helper *helper, struct weston_surface *surface,
+	      int32_t x, int32_t y)
 {
-	struct shell_helper *helper = wl_resource_get_user_data(resource);
-	struct weston_surface *surface =
-		wl_resource_get_user_data(surface_resource);
 	struct weston_view *view;
 	struct slide *slide;
 
-	wl_list_for_each(slide, &helper->slide_list, link) {
-		if (slide->surface == surface) {
-			if (slide->state == SLIDE_STATE_SLIDING_BACK)
-				slide->request = SLIDE_REQUEST_OUT;
-			return;
-		}
+	/* every request is answered with slide_done, even when there is
+	 * nothing to do, so the client never waits for one */
+	slide = slide_find(helper, surface);
+	if (slide) {
+		if (slide->state == SLIDE_STATE_SLIDING_BACK)
+			slide_out(slide);
+		else if (slide->state == SLIDE_STATE_DRAGGED)
+			slide->request = SLIDE_REQUEST_OUT;
+		else if (slide->state == SLIDE_STATE_OUT)
+			slide_send_done(slide);
+		return;
 	}
 
 	view = container_of(surface->views.next, struct weston_view, surface_link);
 
-	if (!view)
+	if (!view) {
+		send_slide_done(helper, surface);
 		return;
+	}
 
-	slide = malloc(sizeof *slide);
-	if (!slide)
+	slide = slide_alloc(helper);
+	if (!slide) {
+		send_slide_done(helper, surface);
 		return;
+	}
 
+	slide->helper = helper;
 	slide->surface = surface;
 	slide->view = view;
 	slide->x = x;
@@ -329,135 +780,1316 @@ shell_helper_slide_surface(struct wl_client *client,
 
 	slide->state = SLIDE_STATE_NONE;
 	slide->request = SLIDE_REQUEST_NONE;
+	anim_init(&slide->anim, 1.0, slide_anim_frame, slide_anim_done);
+
+	weston_matrix_init(&slide->transform.matrix);
+	wl_list_insert(&view->transform.position.link,
+		       &slide->transform.link);
+
+	slide->surface_destroy_listener.notify = slide_surface_destroyed;
+	wl_signal_add(&surface->destroy_signal,
+		      &slide->surface_destroy_listener);
 
 	wl_list_insert(&helper->slide_list,
 		       &slide->link);
+	g_hash_table_insert(helper->slides, surface, slide);
 
 	slide_out(slide);
 }
 
 static void
-shell_helper_slide_surface_back(struct wl_client *client,
-				struct wl_resource *resource,
-				struct wl_resource *surface_resource)
+shell_helper_slide_surface(struct wl_client *client,
+			   struct wl_resource *resource,
+			   struct wl_resource *surface_resource,
+			   int32_t x,
+			   int32_t y)
 {
 	struct shell_helper *helper = wl_resource_get_user_data(resource);
 	struct weston_surface *surface =
 		wl_resource_get_user_data(surface_resource);
-	struct weston_view *view;
-	int found = 0;
-	struct slide *slide;
 
-	wl_list_for_each(slide, &helper->slide_list, link) {
-		if (slide->surface == surface) {
-			found = 1;
-			break;
-		}
+	if (batch_queue(resource, BATCH_OP_SLIDE, surface, x, y))
+		return;
+
+	slide_surface(helper, surface, x, y);
+}
+
+static void
+slide_surface_back(struct shell_helper *helper,
+		   struct weston_surface *surface)
+{
+	struct slide *slide = slide_find(helper, surface);
+
+	/* already back */
+	if (!slide) {
+		send_slide_done(helper, surface);
+		return;
 	}
 
-	if (!found || slide->state == SLIDE_STATE_SLIDING_BACK)
+	if (slide->state == SLIDE_STATE_SLIDING_BACK)
 		return;
 
-	if (slide->state == SLIDE_STATE_SLIDING_OUT)
+	if (slide->state == SLIDE_STATE_DRAGGED)
 		slide->request = SLIDE_REQUEST_BACK;
 	else
 		slide_back(slide);
 }
 
-/* mostly copied from weston's desktop-shell/shell.c */
-static struct weston_view *
-shell_curtain_create_view(struct shell_helper *helper,
-			  struct weston_surface *surface)
+static void
+shell_helper_slide_surface_back(struct wl_client *client,
+				struct wl_resource *resource,
+				struct wl_resource *surface_resource)
 {
-	struct weston_view *view;
+	struct shell_helper *helper = wl_resource_get_user_data(resource);
+	struct weston_surface *surface =
+		wl_resource_get_user_data(surface_resource);
 
-	if (!surface)
-		return NULL;
+	if (batch_queue(resource, BATCH_OP_SLIDE_BACK, surface, 0, 0))
+		return;
 
-	view = weston_view_create(surface);
-	if (!view) {
-		return NULL;
-	}
+	slide_surface_back(helper, surface);
+}
+
+/* a surface the compositor slides back by itself when the pointer
+ * reaches the edge, so revealing does not wait for the client */
+struct edge_surface {
+	struct shell_helper *helper;
+	struct weston_surface *surface;
+	struct wl_resource *resource; /* the helper resource to notify */
+	uint32_t zone;
+
+	struct wl_listener destroy_listener;
+	struct wl_list link;
+};
+
+struct edge_seat {
+	struct shell_helper *helper;
+	struct weston_seat *seat;
+	struct weston_pointer *pointer;
+	int in_edge;
+
+	struct wl_listener caps_listener;
+	struct wl_listener seat_destroy_listener;
+	struct wl_listener motion_listener;
+	struct wl_listener pointer_destroy_listener;
+
+	/* what had the keyboard before keyboard_focus took it */
+	struct weston_surface *saved_focus;
+	int focus_taken;
+	struct wl_listener saved_focus_destroy_listener;
+};
+
+static void
+edge_surface_destroy(struct edge_surface *edge)
+{
+	wl_list_remove(&edge->destroy_listener.link);
+	wl_list_remove(&edge->link);
+	free(edge);
+}
+
+static void
+edge_surface_destroyed(struct wl_listener *listener, void *data)
+{
+	struct edge_surface *edge =
+		container_of(listener, struct edge_surface, destroy_listener);
+
+	edge_surface_destroy(edge);
+}
+
+/* the zone is along the output edge the surface slid out towards,
+ * and only beside the surface itself so the rest of the edge stays
+ * free for whatever else is there */
+static int
+edge_hit(struct edge_surface *edge, wl_fixed_t fx, wl_fixed_t fy,
+	 int32_t zone)
+{
+	struct slide *slide = slide_find(edge->helper, edge->surface);
+	struct weston_output *output;
+	int32_t x = wl_fixed_to_int(fx), y = wl_fixed_to_int(fy);
+	int32_t sx, sy;
+
+	if (!slide)
+		return 0;
+
+	output = slide_output(slide);
+	if (!output)
+		return 0;
+
+	sx = slide->view->geometry.x;
+	sy = slide->view->geometry.y;
+
+	if (slide->x < 0)
+		return x >= output->x && x < output->x + zone &&
+		       y >= sy && y < sy + edge->surface->height;
+	if (slide->x > 0)
+		return x >= output->x + output->width - zone &&
+		       x < output->x + output->width &&
+		       y >= sy && y < sy + edge->surface->height;
+	if (slide->y < 0)
+		return y >= output->y && y < output->y + zone &&
+		       x >= sx && x < sx + edge->surface->width;
+	if (slide->y > 0)
+		return y >= output->y + output->height - zone &&
+		       y < output->y + output->height &&
+		       x >= sx && x < sx + edge->surface->width;
+
+	return 0;
+}
+
+/* input event timestamps are CLOCK_MONOTONIC milliseconds as well,
+ * so the client can compare this with its own clock */
+static uint32_t
+reveal_time(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/* the older events for clients which do not know about newer ones.
+ * edge_revealed says nothing about which surface, so it is only sent
+ * once to each resource. */
+static void
+edge_send_revealed(struct edge_surface *edge, struct wl_resource **notified,
+		   int touch)
+{
+	uint32_t version = wl_resource_get_version(edge->resource);
+
+	if (version >= 12)
+		shell_helper_send_reveal_time(edge->resource, reveal_time());
+
+	if (touch && version >= 9) {
+		shell_helper_send_touch_revealed(edge->resource,
+						 edge->surface->resource);
+	} else if (version >= 7) {
+		shell_helper_send_surface_revealed(edge->resource,
+						   edge->surface->resource);
+	} else if (edge->resource != *notified && version >= 6) {
+		shell_helper_send_edge_revealed(edge->resource);
+		*notified = edge->resource;
+	}
+}
+
+/* runs for every pointer motion, so it only walks the few registered
+ * surfaces and does nothing else unless the pointer just arrived in
+ * the zone */
+static void
+edge_pointer_motion(struct wl_listener *listener, void *data)
+{
+	struct edge_seat *es =
+		container_of(listener, struct edge_seat, motion_listener);
+	struct shell_helper *helper = es->helper;
+	struct weston_pointer *pointer = data;
+	struct edge_surface *edge;
+	struct weston_output *output = NULL;
+	struct wl_resource *notified = NULL;
+	int in_edge = 0;
+
+	wl_list_for_each(edge, &helper->edge_list, link) {
+		if (edge_hit(edge, pointer->x, pointer->y, edge->zone)) {
+			in_edge = 1;
+			output = slide_output(slide_find(helper,
+							 edge->surface));
+			break;
+		}
+	}
+
+	if (in_edge == es->in_edge)
+		return;
+
+	es->in_edge = in_edge;
+	if (!in_edge)
+		return;
+
+	/* every output has its own panel; only reveal the one there */
+	wl_list_for_each(edge, &helper->edge_list, link) {
+		struct slide *slide = slide_find(helper, edge->surface);
+
+		/* a finger is already on it */
+		if (!slide || slide->state == SLIDE_STATE_SLIDING_BACK ||
+		    slide->state == SLIDE_STATE_DRAGGED ||
+		    slide_output(slide) != output)
+			continue;
+
+		slide_surface_back(helper, edge->surface);
+		edge_send_revealed(edge, &notified, 0);
+	}
+}
+
+static void
+edge_pointer_destroyed(struct wl_listener *listener, void *data)
+{
+	struct edge_seat *es =
+		container_of(listener, struct edge_seat,
+			     pointer_destroy_listener);
+
+	wl_list_remove(&es->motion_listener.link);
+	wl_list_remove(&es->pointer_destroy_listener.link);
+	es->pointer = NULL;
+	es->in_edge = 0;
+}
+
+static void
+edge_seat_caps_updated(struct wl_listener *listener, void *data)
+{
+	struct edge_seat *es =
+		container_of(listener, struct edge_seat, caps_listener);
+	struct weston_pointer *pointer = weston_seat_get_pointer(es->seat);
+
+	if (!pointer || pointer == es->pointer)
+		return;
+
+	es->pointer = pointer;
+	es->motion_listener.notify = edge_pointer_motion;
+	wl_signal_add(&pointer->motion_signal, &es->motion_listener);
+	es->pointer_destroy_listener.notify = edge_pointer_destroyed;
+	wl_signal_add(&pointer->destroy_signal,
+		      &es->pointer_destroy_listener);
+}
+
+static void
+edge_seat_destroyed(struct wl_listener *listener, void *data)
+{
+	struct edge_seat *es =
+		container_of(listener, struct edge_seat, seat_destroy_listener);
+
+	if (es->pointer)
+		edge_pointer_destroyed(&es->pointer_destroy_listener, NULL);
+	if (es->saved_focus)
+		wl_list_remove(&es->saved_focus_destroy_listener.link);
+
+	wl_list_remove(&es->caps_listener.link);
+	wl_list_remove(&es->seat_destroy_listener.link);
+	free(es);
+}
+
+static void
+edge_seat_created(struct wl_listener *listener, void *data)
+{
+	struct shell_helper *helper =
+		container_of(listener, struct shell_helper,
+			     seat_created_listener);
+	struct weston_seat *seat = data;
+	struct edge_seat *es;
+
+	es = zalloc(sizeof *es);
+	if (!es)
+		return;
+
+	es->helper = helper;
+	es->seat = seat;
+
+	es->caps_listener.notify = edge_seat_caps_updated;
+	wl_signal_add(&seat->updated_caps_signal, &es->caps_listener);
+	es->seat_destroy_listener.notify = edge_seat_destroyed;
+	wl_signal_add(&seat->destroy_signal, &es->seat_destroy_listener);
+
+	edge_seat_caps_updated(&es->caps_listener, seat);
+}
+
+static void
+shell_helper_reveal_on_edge(struct wl_client *client,
+			    struct wl_resource *resource,
+			    struct wl_resource *surface_resource,
+			    uint32_t zone)
+{
+	struct shell_helper *helper = wl_resource_get_user_data(resource);
+	struct weston_surface *surface =
+		wl_resource_get_user_data(surface_resource);
+	struct edge_surface *edge;
+
+	wl_list_for_each(edge, &helper->edge_list, link) {
+		if (edge->surface == surface)
+			break;
+	}
+
+	if (&edge->link == &helper->edge_list) {
+		if (zone == 0)
+			return;
+
+		edge = zalloc(sizeof *edge);
+		if (!edge) {
+			wl_client_post_no_memory(client);
+			return;
+		}
+
+		edge->helper = helper;
+		edge->surface = surface;
+		edge->destroy_listener.notify = edge_surface_destroyed;
+		wl_signal_add(&surface->destroy_signal,
+			      &edge->destroy_listener);
+		wl_list_insert(&helper->edge_list, &edge->link);
+	} else if (zone == 0) {
+		edge_surface_destroy(edge);
+		return;
+	}
+
+	edge->resource = resource;
+	edge->zone = zone;
+}
+
+/* the launcher opens on the output the pointer is on */
+static void
+launcher_key(struct shell_helper *helper, struct weston_seat *seat)
+{
+	struct weston_pointer *pointer = weston_seat_get_pointer(seat);
+	struct weston_output *output = NULL, *o;
+	struct wl_resource *resource, *output_resource;
+
+	if (pointer) {
+		wl_list_for_each(o, &helper->compositor->output_list, link) {
+			if (pixman_region32_contains_point(&o->region,
+					wl_fixed_to_int(pointer->x),
+					wl_fixed_to_int(pointer->y), NULL)) {
+				output = o;
+				break;
+			}
+		}
+	}
+
+	wl_resource_for_each(resource, &helper->resource_list) {
+		if (wl_resource_get_version(resource) < 8)
+			continue;
+
+		output_resource = NULL;
+		if (output)
+			output_resource = wl_resource_find_for_client(
+				&output->resource_list,
+				wl_resource_get_client(resource));
+
+		shell_helper_send_launcher_key(resource, output_resource);
+	}
+}
+
+/* only run when super is released without any other key or button
+ * in between, so the shell's own super bindings keep working */
+#ifdef HAVE_NEW_WESTON
+static void
+launcher_modifier_binding(struct weston_keyboard *keyboard,
+			  enum weston_keyboard_modifier modifier, void *data)
+{
+	launcher_key(data, keyboard->seat);
+}
+#else
+static void
+launcher_modifier_binding(struct weston_seat *seat,
+			  enum weston_keyboard_modifier modifier, void *data)
+{
+	launcher_key(data, seat);
+}
+#endif
+
+static void
+saved_focus_destroyed(struct wl_listener *listener, void *data)
+{
+	struct edge_seat *es =
+		container_of(listener, struct edge_seat,
+			     saved_focus_destroy_listener);
+
+	wl_list_remove(&es->saved_focus_destroy_listener.link);
+	es->saved_focus = NULL;
+}
+
+static void
+seat_take_focus(struct edge_seat *es, struct weston_keyboard *keyboard,
+		struct weston_surface *surface)
+{
+	if (!es->focus_taken) {
+		es->focus_taken = 1;
+		es->saved_focus = keyboard->focus;
+		if (es->saved_focus) {
+			es->saved_focus_destroy_listener.notify =
+				saved_focus_destroyed;
+			wl_signal_add(&es->saved_focus->destroy_signal,
+				      &es->saved_focus_destroy_listener);
+		}
+	}
+
+	weston_keyboard_set_focus(keyboard, surface);
+}
+
+static void
+seat_give_focus_back(struct edge_seat *es, struct weston_keyboard *keyboard,
+		     struct wl_client *client)
+{
+	struct weston_surface *focus = keyboard->focus;
+
+	if (!es->focus_taken)
+		return;
+
+	/* unless the user already picked something else */
+	if (focus && focus->resource &&
+	    wl_resource_get_client(focus->resource) == client)
+		weston_keyboard_set_focus(keyboard, es->saved_focus);
+
+	if (es->saved_focus)
+		wl_list_remove(&es->saved_focus_destroy_listener.link);
+	es->saved_focus = NULL;
+	es->focus_taken = 0;
+}
+
+static void
+shell_helper_keyboard_focus(struct wl_client *client,
+			    struct wl_resource *resource,
+			    struct wl_resource *surface_resource)
+{
+	struct shell_helper *helper = wl_resource_get_user_data(resource);
+	struct weston_surface *surface = NULL;
+	struct weston_seat *seat;
+	struct weston_keyboard *keyboard;
+	struct edge_seat *es;
+	struct wl_listener *listener;
+
+	if (surface_resource)
+		surface = wl_resource_get_user_data(surface_resource);
+
+	wl_list_for_each(seat, &helper->compositor->seat_list, link) {
+		keyboard = weston_seat_get_keyboard(seat);
+		listener = wl_signal_get(&seat->destroy_signal,
+					 edge_seat_destroyed);
+		if (!keyboard || !listener)
+			continue;
+
+		es = container_of(listener, struct edge_seat,
+				  seat_destroy_listener);
+
+		if (surface)
+			seat_take_focus(es, keyboard, surface);
+		else
+			seat_give_focus_back(es, keyboard, client);
+	}
+}
+
+/* a finger swiping the surfaces at an output edge back into view.
+ * they follow the finger, and when it lets go a critically damped
+ * spring carries them the rest of the way, starting at the speed the
+ * finger had, rather than replaying a fixed slide. */
+
+/* fingers are wider than a pointer is precise */
+#define SWIPE_ZONE_MIN 24
+/* where the surfaces would be this long after letting go decides
+ * whether they settle in place or slide out again */
+#define SWIPE_PROJECT_MS 150.0
+/* the spring's angular frequency, per ms */
+#define SWIPE_SPRING 0.035
+#define SWIPE_STEP_MS 4
+
+struct swipe {
+	struct weston_touch_grab grab;
+	struct shell_helper *helper;
+	struct weston_output *output;
+	int grabbing;
+	int touch_id; /* the finger which started it, once known */
+
+	/* the touched surface slides along this, in pixels; the others
+	 * on the output follow in proportion */
+	int32_t slide_x, slide_y;
+	wl_fixed_t start_x, start_y, last_x, last_y;
+	MaynardVelocity velocity;
+
+	double progress; /* 0 slid out, 1 back in place */
+	double speed; /* progress per ms */
+	double target;
+	uint32_t last_msecs;
+
+	struct weston_animation animation;
+	struct wl_listener output_destroy_listener;
+};
+
+/* how much of the way back dx, dy goes. surfaces only slide along
+ * one axis, so this is the movement against the slide over its
+ * length. */
+static double
+swipe_forward(struct swipe *swipe, double dx, double dy)
+{
+	double sx = swipe->slide_x, sy = swipe->slide_y;
+
+	return -(dx * sx + dy * sy) / (sx * sx + sy * sy);
+}
+
+static void
+swipe_set_progress(struct swipe *swipe, double progress)
+{
+	struct slide *slide;
+
+	swipe->progress = progress;
+
+	wl_list_for_each(slide, &swipe->helper->slide_list, link) {
+		if (slide->state != SLIDE_STATE_DRAGGED)
+			continue;
+
+		slide_set_offset(slide, 1.0 - progress);
+	}
+
+	weston_output_schedule_repaint(swipe->output);
+}
+
+/* hand the slides back to the usual state machine, with whatever the
+ * client asked for in the meantime */
+static void
+swipe_finish(struct swipe *swipe)
+{
+	struct shell_helper *helper = swipe->helper;
+	struct slide *slide, *next;
+	enum SlideRequest request;
+	int back = swipe->target > 0.5;
+
+	swipe_set_progress(swipe, back ? 1.0 : 0.0);
+
+	wl_list_for_each_safe(slide, next, &helper->slide_list, link) {
+		if (slide->state != SLIDE_STATE_DRAGGED)
+			continue;
+
+		/* either may be over before it returns */
+		request = slide->request;
+		slide->request = SLIDE_REQUEST_NONE;
+
+		if (back) {
+			if (request == SLIDE_REQUEST_OUT)
+				slide_out(slide);
+			else
+				slide_arrived_back(slide);
+		} else {
+			/* already out, so asking for that is answered */
+			slide->state = SLIDE_STATE_OUT;
+			if (request == SLIDE_REQUEST_BACK)
+				slide_back(slide);
+			else if (request == SLIDE_REQUEST_OUT)
+				slide_send_done(slide);
+		}
+	}
+
+	if (swipe->grabbing)
+		weston_touch_end_grab(swipe->grab.touch);
+	if (!wl_list_empty(&swipe->animation.link))
+		wl_list_remove(&swipe->animation.link);
+	wl_list_remove(&swipe->output_destroy_listener.link);
+
+	helper->swipe = NULL;
+	free(swipe);
+}
+
+static void
+swipe_frame(struct weston_animation *animation,
+	    struct weston_output *output, uint32_t msecs)
+{
+	struct swipe *swipe =
+		container_of(animation, struct swipe, animation);
+	double progress = swipe->progress;
+	uint32_t elapsed;
+	double h, accel;
+
+	if (animation->frame_counter <= 1)
+		swipe->last_msecs = msecs;
+
+	elapsed = msecs - swipe->last_msecs;
+	swipe->last_msecs = msecs;
+
+	/* small fixed steps keep the spring stable on slow frames */
+	while (elapsed > 0) {
+		h = elapsed < SWIPE_STEP_MS ? elapsed : SWIPE_STEP_MS;
+		accel = -2.0 * SWIPE_SPRING * swipe->speed -
+			SWIPE_SPRING * SWIPE_SPRING *
+			(progress - swipe->target);
+		swipe->speed += accel * h;
+		progress += swipe->speed * h;
+		elapsed -= h;
+	}
+
+	/* a fast flick may overshoot; stop at the end instead */
+	if ((swipe->target > 0.5 && progress >= 1.0 - 0.002) ||
+	    (swipe->target < 0.5 && progress <= 0.002) ||
+	    (fabs(progress - swipe->target) < 0.002 &&
+	     fabs(swipe->speed) < 0.0005)) {
+		swipe_finish(swipe);
+		return;
+	}
+
+	swipe_set_progress(swipe, progress);
+}
+
+static void
+swipe_release(struct swipe *swipe, uint32_t time)
+{
+	struct shell_helper *helper = swipe->helper;
+	struct wl_resource *notified = NULL;
+	struct edge_surface *edge;
+	struct slide *slide;
+	double vx, vy;
+
+	/* it may have stopped moving before letting go */
+	maynard_velocity_add(&swipe->velocity, time,
+			     wl_fixed_to_double(swipe->last_x),
+			     wl_fixed_to_double(swipe->last_y));
+	maynard_velocity_get(&swipe->velocity, &vx, &vy);
+
+	swipe->speed = swipe_forward(swipe, vx, vy);
+	swipe->target =
+		swipe->progress + swipe->speed * SWIPE_PROJECT_MS >= 0.5 ?
+		1.0 : 0.0;
+
+	weston_touch_end_grab(swipe->grab.touch);
+	swipe->grabbing = 0;
+
+	if (swipe->target > 0.5) {
+		wl_list_for_each(edge, &helper->edge_list, link) {
+			slide = slide_find(helper, edge->surface);
+			if (slide && slide->state == SLIDE_STATE_DRAGGED)
+				edge_send_revealed(edge, &notified, 1);
+		}
+	}
+
+	swipe->animation.frame_counter = 0;
+	swipe->animation.frame = swipe_frame;
+	wl_list_insert(&swipe->output->animation_list,
+		       &swipe->animation.link);
+	weston_output_schedule_repaint(swipe->output);
+}
+
+static void
+swipe_grab_down(struct weston_touch_grab *grab, uint32_t time,
+		int touch_id, wl_fixed_t sx, wl_fixed_t sy)
+{
+	/* other fingers are ignored until this one is done */
+}
+
+static void
+swipe_grab_up(struct weston_touch_grab *grab, uint32_t time, int touch_id)
+{
+	struct swipe *swipe = container_of(grab, struct swipe, grab);
+
+	if (swipe->touch_id != -1 && touch_id != swipe->touch_id)
+		return;
+
+	swipe_release(swipe, time);
+}
+
+static void
+swipe_grab_motion(struct weston_touch_grab *grab, uint32_t time,
+		  int touch_id, wl_fixed_t x, wl_fixed_t y)
+{
+	struct swipe *swipe = container_of(grab, struct swipe, grab);
+	double progress;
+
+	if (swipe->touch_id == -1)
+		swipe->touch_id = touch_id;
+	else if (touch_id != swipe->touch_id)
+		return;
+
+	swipe->last_x = x;
+	swipe->last_y = y;
+	maynard_velocity_add(&swipe->velocity, time,
+			     wl_fixed_to_double(x), wl_fixed_to_double(y));
+
+	progress = swipe_forward(swipe,
+				 wl_fixed_to_double(x - swipe->start_x),
+				 wl_fixed_to_double(y - swipe->start_y));
+	if (progress < 0.0)
+		progress = 0.0;
+	if (progress > 1.0)
+		progress = 1.0;
+
+	swipe_set_progress(swipe, progress);
+}
+
+#ifdef HAVE_NEW_WESTON
+static void
+swipe_grab_frame(struct weston_touch_grab *grab)
+{
+}
+
+static void
+swipe_grab_cancel(struct weston_touch_grab *grab)
+{
+	struct swipe *swipe = container_of(grab, struct swipe, grab);
+
+	swipe->target = 0.0;
+	swipe_finish(swipe);
+}
+#endif
+
+static const struct weston_touch_grab_interface swipe_grab_interface = {
+	.down = swipe_grab_down,
+	.up = swipe_grab_up,
+	.motion = swipe_grab_motion,
+#ifdef HAVE_NEW_WESTON
+	.frame = swipe_grab_frame,
+	.cancel = swipe_grab_cancel,
+#endif
+};
+
+static void
+swipe_output_destroyed(struct wl_listener *listener, void *data)
+{
+	struct swipe *swipe =
+		container_of(listener, struct swipe, output_destroy_listener);
+
+	swipe_finish(swipe);
+}
+
+/* the client under the finger already got the down event; it will
+ * not see the rest of this touch, so tell it to forget about it */
+static void
+swipe_cancel_focus(struct weston_touch *touch)
+{
+	struct wl_resource *resource;
+
+	wl_resource_for_each(resource, &touch->focus_resource_list)
+		wl_touch_send_cancel(resource);
+}
+
+static void
+swipe_start(struct shell_helper *helper, struct weston_touch *touch,
+	    struct slide *touched, uint32_t time)
+{
+	struct edge_surface *edge;
+	struct slide *slide;
+	struct swipe *swipe;
+
+	swipe = zalloc(sizeof *swipe);
+	if (!swipe)
+		return;
+
+	swipe->helper = helper;
+	swipe->output = slide_output(touched);
+	swipe->touch_id = -1;
+	swipe->slide_x = touched->x;
+	swipe->slide_y = touched->y;
+	swipe->start_x = swipe->last_x = touch->grab_x;
+	swipe->start_y = swipe->last_y = touch->grab_y;
+	maynard_velocity_reset(&swipe->velocity);
+	maynard_velocity_add(&swipe->velocity, time,
+			     wl_fixed_to_double(touch->grab_x),
+			     wl_fixed_to_double(touch->grab_y));
+	wl_list_init(&swipe->animation.link);
+
+	swipe->output_destroy_listener.notify = swipe_output_destroyed;
+	wl_signal_add(&swipe->output->destroy_signal,
+		      &swipe->output_destroy_listener);
+
+	/* everything slid out at this edge of the output comes along */
+	wl_list_for_each(edge, &helper->edge_list, link) {
+		slide = slide_find(helper, edge->surface);
+		if (slide && slide->state == SLIDE_STATE_OUT &&
+		    slide_output(slide) == swipe->output)
+			slide->state = SLIDE_STATE_DRAGGED;
+	}
+
+	helper->swipe = swipe;
+
+	swipe_cancel_focus(touch);
+
+	swipe->grab.interface = &swipe_grab_interface;
+	weston_touch_start_grab(touch, &swipe->grab);
+	swipe->grabbing = 1;
+}
+
+static void
+touch_down(struct shell_helper *helper, struct weston_touch *touch,
+	   uint32_t time)
+{
+	struct edge_surface *edge;
+	struct slide *slide = NULL;
+	struct wl_resource *resource;
+	struct wl_client *client = NULL;
+
+	if (touch->focus && touch->focus->surface->resource)
+		client = wl_resource_get_client(
+			touch->focus->surface->resource);
+
+	wl_resource_for_each(resource, &helper->resource_list) {
+		if (wl_resource_get_version(resource) >= 9 &&
+		    wl_resource_get_client(resource) != client)
+			shell_helper_send_touch_elsewhere(resource);
+	}
+
+	if (helper->swipe)
+		return;
+
+	wl_list_for_each(edge, &helper->edge_list, link) {
+		if (edge_hit(edge, touch->grab_x, touch->grab_y,
+			     edge->zone > SWIPE_ZONE_MIN ?
+			     edge->zone : SWIPE_ZONE_MIN)) {
+			slide = slide_find(helper, edge->surface);
+			break;
+		}
+	}
+
+	if (slide && slide->state == SLIDE_STATE_OUT)
+		swipe_start(helper, touch, slide, time);
+}
+
+/* only run for the first finger going down */
+#ifdef HAVE_NEW_WESTON
+static void
+swipe_touch_binding(struct weston_touch *touch, uint32_t time, void *data)
+{
+	touch_down(data, touch, time);
+}
+#else
+static void
+swipe_touch_binding(struct weston_seat *seat, uint32_t time, void *data)
+{
+	touch_down(data, weston_seat_get_touch(seat), time);
+}
+#endif
+
+/* cover every output, wherever they are placed */
+static void
+curtain_update_size(struct shell_helper *helper)
+{
+	struct weston_surface *surface = helper->curtain_surface;
+	struct weston_output *output;
+	int32_t x1 = 0, y1 = 0, x2 = 0, y2 = 0;
+	int first = 1;
+
+	wl_list_for_each(output, &helper->compositor->output_list, link) {
+		if (first || output->x < x1)
+			x1 = output->x;
+		if (first || output->y < y1)
+			y1 = output->y;
+		if (first || output->x + output->width > x2)
+			x2 = output->x + output->width;
+		if (first || output->y + output->height > y2)
+			y2 = output->y + output->height;
+		first = 0;
+	}
+
+	weston_surface_set_size(surface, x2 - x1, y2 - y1);
+	weston_view_set_position(helper->curtain_view, x1, y1);
+
+	pixman_region32_fini(&surface->input);
+	pixman_region32_init_rect(&surface->input, 0, 0,
+				  surface->width, surface->height);
+
+	weston_view_geometry_dirty(helper->curtain_view);
+}
+
+/* mostly copied from weston's desktop-shell/shell.c */
+static struct weston_view *
+shell_curtain_create_view(struct shell_helper *helper,
+			  struct weston_surface *surface)
+{
+	struct weston_view *view;
+
+	if (!surface) {
+		/* no buffer is ever attached; the renderer just fills
+		 * the surface with its solid colour */
+		surface = weston_surface_create(helper->compositor);
+		if (!surface)
+			return NULL;
+
+		helper->curtain_surface = surface;
+	}
+
+	view = weston_view_create(surface);
+	if (!view) {
+		return NULL;
+	}
 
 	weston_view_set_position(view, 0, 0);
 	weston_surface_set_color(surface, 0.0, 0.0, 0.0, 0.7);
 	weston_layer_entry_insert(&helper->curtain_layer.view_list,
 				  &view->layer_link);
-	pixman_region32_init_rect(&surface->input, 0, 0,
-	                          surface->width,
-	                          surface->height);
+
+	if (helper->curtain_surface) {
+		helper->curtain_view = view;
+		curtain_update_size(helper);
+	} else {
+		pixman_region32_init_rect(&surface->input, 0, 0,
+					  surface->width,
+					  surface->height);
+	}
 
 	return view;
 }
 
 static void
-curtain_done_hide(struct weston_view_animation *animation,
-		  void *data);
+curtain_anim_frame(struct anim *anim, double alpha)
+{
+	struct shell_helper *helper =
+		container_of(anim, struct shell_helper, curtain_anim);
+
+	helper->curtain_view->alpha = alpha;
+	weston_view_geometry_dirty(helper->curtain_view);
+	weston_view_schedule_repaint(helper->curtain_view);
+}
 
 static void
-curtain_fade_done(struct weston_view_animation *animation,
-		  void *data)
+curtain_anim_done(struct anim *anim)
 {
-	struct shell_helper *helper = data;
+	struct shell_helper *helper =
+		container_of(anim, struct shell_helper, curtain_anim);
 
 	if (!helper->curtain_show)
 		wl_list_remove(&helper->curtain_layer.link);
-
-	helper->curtain_animation = NULL;
 }
 
+/* the client may destroy the surface it gave us, fading or not */
 static void
-shell_helper_curtain(struct wl_client *client,
-		     struct wl_resource *resource,
-		     struct wl_resource *surface_resource,
-		     int32_t show)
+curtain_view_destroyed(struct wl_listener *listener, void *data)
 {
-	struct shell_helper *helper = wl_resource_get_user_data(resource);
-	struct weston_surface *surface =
-		wl_resource_get_user_data(surface_resource);
+	struct shell_helper *helper =
+		container_of(listener, struct shell_helper,
+			     curtain_view_destroy_listener);
 
-	helper->curtain_show = show;
+	if (helper->curtain_anim.running || helper->curtain_anim.value > 0.0)
+		wl_list_remove(&helper->curtain_layer.link);
 
-	if (show) {
-		if (helper->curtain_animation) {
-			weston_fade_update(helper->curtain_animation, 0.7);
-			return;
-		}
+	anim_stop(&helper->curtain_anim);
+	helper->curtain_anim.value = 0.0;
+	helper->curtain_view = NULL;
+	helper->curtain_show = 0;
+}
+
+static void
+curtain_fade(struct shell_helper *helper, struct weston_surface *surface,
+	     int32_t show)
+{
+	/* gone, and not on its way back */
+	int hidden = !helper->curtain_anim.running &&
+		helper->curtain_anim.value == 0.0;
 
+	if (show) {
 		if (!helper->curtain_view) {
 			weston_layer_init(&helper->curtain_layer,
 					  &helper->panel_layer->link);
 
 			helper->curtain_view = shell_curtain_create_view(helper, surface);
+			if (!helper->curtain_view)
+				return;
+
+			helper->curtain_view_destroy_listener.notify =
+				curtain_view_destroyed;
+			wl_signal_add(&helper->curtain_view->destroy_signal,
+				      &helper->curtain_view_destroy_listener);
 
 			/* we need to assign an output to the view before we can
 			* fade it in */
 			weston_view_geometry_dirty(helper->curtain_view);
 			weston_view_update_transform(helper->curtain_view);
-		} else {
+		} else if (hidden) {
 			wl_list_insert(&helper->panel_layer->link, &helper->curtain_layer.link);
-		}
-
-		helper->curtain_animation = weston_fade_run(
-			helper->curtain_view,
-			0.0, 0.7, 400,
-			curtain_fade_done, helper);
 
+			/* outputs may have come or gone since last time */
+			if (helper->curtain_surface)
+				curtain_update_size(helper);
+		}
 	} else {
-		if (helper->curtain_animation) {
-			weston_fade_update(helper->curtain_animation, 0.0);
+		/* should never happen in theory */
+		if (!helper->curtain_view || hidden)
 			return;
+	}
+
+	helper->curtain_show = show;
+
+	anim_run(&helper->curtain_anim, helper->curtain_view->output,
+		 &helper->curtain_style, show ? 0.7 : 0.0);
+}
+
+static void
+shell_helper_curtain(struct wl_client *client,
+		     struct wl_resource *resource,
+		     struct wl_resource *surface_resource,
+		     int32_t show)
+{
+	struct shell_helper *helper = wl_resource_get_user_data(resource);
+	struct weston_surface *surface = NULL;
+
+	if (surface_resource)
+		surface = wl_resource_get_user_data(surface_resource);
+
+	if (batch_queue(resource, BATCH_OP_CURTAIN, surface, show, 0))
+		return;
+
+	curtain_fade(helper, surface, show);
+}
+
+struct crossfade {
+	struct wl_resource *resource;
+	struct weston_surface *surface;
+	struct weston_view *view;
+	struct weston_view *background_view;
+	int started;
+	struct weston_view_animation *animation; /* while fading */
+
+	struct wl_listener surface_destroy_listener;
+	struct wl_listener resource_destroy_listener;
+};
+
+static void
+crossfade_done(struct weston_view_animation *animation, void *data)
+{
+	struct crossfade *crossfade = data;
+
+	crossfade->animation = NULL;
+
+	/* cut short, see crossfade_surface_destroyed */
+	if (!crossfade->surface) {
+		free(crossfade);
+		return;
+	}
+
+	if (crossfade->resource)
+		shell_helper_send_crossfade_finished(crossfade->resource,
+						     crossfade->surface->resource);
+}
+
+static void
+configure_crossfade(struct weston_surface *es, int32_t sx, int32_t sy)
+{
+	#ifdef HAVE_NEW_WESTON
+	struct crossfade *crossfade = es->committed_private;
+	#else
+	struct crossfade *crossfade = es->configure_private;
+	#endif
+	struct weston_view *background_view = crossfade->background_view;
+	struct weston_layer_entry *above;
+
+	/* wait for the first buffer */
+	if (crossfade->started || es->width == 0)
+		return;
+
+	crossfade->started = 1;
+
+	/* views earlier in the layer list are stacked higher, so go in
+	 * right before the background */
+	above = container_of(background_view->layer_link.link.prev,
+			     struct weston_layer_entry, link);
+	weston_layer_entry_insert(above, &crossfade->view->layer_link);
+
+	weston_view_set_position(crossfade->view,
+				 background_view->geometry.x,
+				 background_view->geometry.y);
+	weston_view_update_transform(crossfade->view);
+
+	crossfade->animation = weston_fade_run(crossfade->view, 1.0, 0.0, 400,
+					       crossfade_done, crossfade);
+}
+
+static void
+crossfade_surface_destroyed(struct wl_listener *listener, void *data)
+{
+	struct crossfade *crossfade =
+		container_of(listener, struct crossfade,
+			     surface_destroy_listener);
+
+	wl_list_remove(&crossfade->surface_destroy_listener.link);
+	if (crossfade->resource)
+		wl_list_remove(&crossfade->resource_destroy_listener.link);
+
+	/* the views go right after this, and take the fade with them.
+	 * it still calls crossfade_done, so leave the freeing to that,
+	 * with nothing left to tell the client about */
+	if (crossfade->animation) {
+		crossfade->surface = NULL;
+		crossfade->resource = NULL;
+		return;
+	}
+
+	free(crossfade);
+}
+
+static void
+crossfade_resource_destroyed(struct wl_listener *listener, void *data)
+{
+	struct crossfade *crossfade =
+		container_of(listener, struct crossfade,
+			     resource_destroy_listener);
+
+	wl_list_remove(&crossfade->resource_destroy_listener.link);
+	crossfade->resource = NULL;
+}
+
+static void
+shell_helper_crossfade(struct wl_client *client,
+		       struct wl_resource *resource,
+		       struct wl_resource *surface_resource,
+		       struct wl_resource *background_surface_resource)
+{
+	struct weston_surface *surface =
+		wl_resource_get_user_data(surface_resource);
+	struct weston_surface *background_surface =
+		wl_resource_get_user_data(background_surface_resource);
+	struct weston_view *view, *next;
+	struct crossfade *crossfade;
+
+	#ifdef HAVE_NEW_WESTON
+	if (surface->committed) {
+	#else
+	if (surface->configure) {
+	#endif
+		wl_resource_post_error(surface_resource,
+				       WL_DISPLAY_ERROR_INVALID_OBJECT,
+				       "surface role already assigned");
+		return;
+	}
+
+	if (wl_list_empty(&background_surface->views))
+		return;
+
+	crossfade = zalloc(sizeof *crossfade);
+	if (!crossfade) {
+		wl_client_post_no_memory(client);
+		return;
+	}
+
+	wl_list_for_each_safe(view, next, &surface->views, surface_link)
+		weston_view_destroy(view);
+
+	crossfade->resource = resource;
+	crossfade->surface = surface;
+	crossfade->view = weston_view_create(surface);
+	crossfade->background_view = container_of(background_surface->views.next,
+						  struct weston_view,
+						  surface_link);
+
+	crossfade->surface_destroy_listener.notify = crossfade_surface_destroyed;
+	wl_signal_add(&surface->destroy_signal,
+		      &crossfade->surface_destroy_listener);
+	crossfade->resource_destroy_listener.notify = crossfade_resource_destroyed;
+	wl_resource_add_destroy_listener(resource,
+					 &crossfade->resource_destroy_listener);
+
+	#ifdef HAVE_NEW_WESTON
+	surface->committed = configure_crossfade;
+	surface->committed_private = crossfade;
+	#else
+	surface->configure = configure_crossfade;
+	surface->configure_private = crossfade;
+	#endif
+	surface->output = crossfade->background_view->output;
+}
+
+/* the client gets no pointer events for a curtain we drew ourselves,
+ * so tell it when somebody clicks on it to dismiss whatever is above */
+static void
+curtain_clicked(struct shell_helper *helper, struct weston_pointer *pointer)
+{
+	struct wl_resource *resource;
+
+	if (!helper->curtain_surface || !helper->curtain_show ||
+	    !pointer || pointer->focus != helper->curtain_view)
+		return;
+
+	wl_resource_for_each(resource, &helper->resource_list) {
+		if (wl_resource_get_version(resource) >= 3)
+			shell_helper_send_curtain_clicked(resource);
+	}
+}
+
+#ifdef HAVE_NEW_WESTON
+static void
+curtain_button_binding(struct weston_pointer *pointer, uint32_t time,
+		       uint32_t button, void *data)
+{
+	curtain_clicked(data, pointer);
+}
+#else
+static void
+curtain_button_binding(struct weston_seat *seat, uint32_t time,
+		       uint32_t button, void *data)
+{
+	curtain_clicked(data, weston_seat_get_pointer(seat));
+}
+#endif
+
+static void
+shell_helper_begin_batch(struct wl_client *client,
+			 struct wl_resource *resource)
+{
+	struct shell_helper *helper = wl_resource_get_user_data(resource);
+	struct batch *batch;
+
+	/* batches don't nest */
+	if (batch_find(resource))
+		return;
+
+	batch = zalloc(sizeof *batch);
+	if (!batch) {
+		wl_resource_post_no_memory(resource);
+		return;
+	}
+
+	batch->resource = resource;
+	wl_list_init(&batch->op_list);
+	wl_list_insert(&helper->batch_list, &batch->link);
+}
+
+/* everything is started from this one request, before the compositor
+ * gets to repaint, and so every animation takes the same frame as its
+ * first */
+static void
+shell_helper_commit_batch(struct wl_client *client,
+			  struct wl_resource *resource)
+{
+	struct shell_helper *helper = wl_resource_get_user_data(resource);
+	struct batch *batch = batch_find(resource);
+	struct batch_op *op;
+
+	if (!batch)
+		return;
+
+	/* requests coming from here on are not queued any more */
+	wl_list_remove(&batch->link);
+	wl_list_init(&batch->link);
+
+	wl_list_for_each(op, &batch->op_list, link) {
+		switch (op->type) {
+		case BATCH_OP_MOVE:
+			move_surface(op->surface, op->x, op->y);
+			break;
+		case BATCH_OP_SLIDE:
+			slide_surface(helper, op->surface, op->x, op->y);
+			break;
+		case BATCH_OP_SLIDE_BACK:
+			slide_surface_back(helper, op->surface);
+			break;
+		case BATCH_OP_CURTAIN:
+			curtain_fade(helper, op->surface, op->x);
+			break;
 		}
+	}
 
-		/* should never happen in theory */
-		if (!helper->curtain_view)
-			return;
+	batch_destroy(batch);
+}
+
+static void
+shell_helper_set_animation(struct wl_client *client,
+			   struct wl_resource *resource,
+			   uint32_t kind,
+			   uint32_t curve,
+			   uint32_t duration)
+{
+	struct shell_helper *helper = wl_resource_get_user_data(resource);
+	struct anim_style *style;
+
+	switch (kind) {
+	case SHELL_HELPER_ANIMATION_KIND_SLIDE:
+		style = &helper->slide_style;
+		break;
+	case SHELL_HELPER_ANIMATION_KIND_CURTAIN:
+		style = &helper->curtain_style;
+		break;
+	default:
+		wl_resource_post_error(resource,
+				       SHELL_HELPER_ERROR_INVALID_ANIMATION,
+				       "unknown animation kind %u", kind);
+		return;
+	}
 
-		helper->curtain_animation = weston_fade_run(
-			helper->curtain_view,
-			0.7, 0.0, 400,
-			curtain_fade_done, helper);
+	if (curve > SHELL_HELPER_CURVE_SPRING) {
+		wl_resource_post_error(resource,
+				       SHELL_HELPER_ERROR_INVALID_ANIMATION,
+				       "unknown curve %u", curve);
+		return;
 	}
+
+	/* the ones already running finish the way they started */
+	style->curve = curve;
+	style->duration = duration;
 }
 
 static const struct shell_helper_interface helper_implementation = {
@@ -466,19 +2098,76 @@ static const struct shell_helper_interface helper_implementation = {
 	shell_helper_set_panel,
 	shell_helper_slide_surface,
 	shell_helper_slide_surface_back,
-	shell_helper_curtain
+	shell_helper_curtain,
+	shell_helper_crossfade,
+	shell_helper_reveal_on_edge,
+	shell_helper_keyboard_focus,
+	shell_helper_begin_batch,
+	shell_helper_commit_batch,
+	shell_helper_set_animation
 };
 
+static void
+unbind_helper(struct wl_resource *resource)
+{
+	struct shell_helper *helper = wl_resource_get_user_data(resource);
+	struct batch *batch = batch_find(resource);
+	struct edge_surface *edge, *next;
+
+	if (batch)
+		batch_destroy(batch);
+
+	/* nobody is left to tell about them */
+	wl_list_for_each_safe(edge, next, &helper->edge_list, link) {
+		if (edge->resource == resource)
+			edge_surface_destroy(edge);
+	}
+
+	wl_list_remove(wl_resource_get_link(resource));
+}
+
 static void
 bind_helper(struct wl_client *client, void *data, uint32_t version, uint32_t id)
 {
 	struct shell_helper *helper = data;
 	struct wl_resource *resource;
 
-	resource = wl_resource_create(client, &shell_helper_interface, 1, id);
-	if (resource)
-		wl_resource_set_implementation(resource, &helper_implementation,
-					       helper, NULL);
+	resource = wl_resource_create(client, &shell_helper_interface,
+				      MIN(version, SHELL_HELPER_VERSION), id);
+	if (!resource) {
+		wl_client_post_no_memory(client);
+		return;
+	}
+
+	wl_resource_set_implementation(resource, &helper_implementation,
+				       helper, unbind_helper);
+	wl_list_insert(&helper->resource_list, wl_resource_get_link(resource));
+}
+
+static void
+helper_idle(struct wl_listener *listener, void *data)
+{
+	struct shell_helper *helper =
+		container_of(listener, struct shell_helper, idle_listener);
+	struct wl_resource *resource;
+
+	wl_resource_for_each(resource, &helper->resource_list) {
+		if (wl_resource_get_version(resource) >= 2)
+			shell_helper_send_idle(resource);
+	}
+}
+
+static void
+helper_wake(struct wl_listener *listener, void *data)
+{
+	struct shell_helper *helper =
+		container_of(listener, struct shell_helper, wake_listener);
+	struct wl_resource *resource;
+
+	wl_resource_for_each(resource, &helper->resource_list) {
+		if (wl_resource_get_version(resource) >= 2)
+			shell_helper_send_wake(resource);
+	}
 }
 
 static void
@@ -486,6 +2175,39 @@ helper_destroy(struct wl_listener *listener, void *data)
 {
 	struct shell_helper *helper =
 		container_of(listener, struct shell_helper, destroy_listener);
+	struct weston_seat *seat;
+	struct wl_listener *seat_listener;
+
+	wl_list_remove(&helper->idle_listener.link);
+	wl_list_remove(&helper->wake_listener.link);
+	wl_list_remove(&helper->seat_created_listener.link);
+
+	/* the seats may outlive us, so take our listeners off them */
+	wl_list_for_each(seat, &helper->compositor->seat_list, link) {
+		seat_listener = wl_signal_get(&seat->destroy_signal,
+					      edge_seat_destroyed);
+		if (seat_listener)
+			edge_seat_destroyed(seat_listener, seat);
+	}
+
+	while (!wl_list_empty(&helper->edge_list))
+		edge_surface_destroy(container_of(helper->edge_list.next,
+						  struct edge_surface, link));
+
+	anim_stop(&helper->curtain_anim);
+	if (helper->curtain_view)
+		wl_list_remove(&helper->curtain_view_destroy_listener.link);
+	if (helper->curtain_surface)
+		weston_surface_destroy(helper->curtain_surface);
+
+	while (!wl_list_empty(&helper->slide_pool)) {
+		struct slide *slide = container_of(helper->slide_pool.next,
+						   struct slide, link);
+
+		wl_list_remove(&slide->link);
+		free(slide);
+	}
+	g_hash_table_destroy(helper->slides);
 
 	free(helper);
 }
@@ -495,6 +2217,7 @@ module_init(struct weston_compositor *ec,
 	    int *argc, char *argv[])
 {
 	struct shell_helper *helper;
+	struct weston_seat *seat;
 
 	helper = zalloc(sizeof *helper);
 	if (helper == NULL)
@@ -504,14 +2227,48 @@ module_init(struct weston_compositor *ec,
 	helper->panel_layer = NULL;
 	helper->curtain_view = NULL;
 	helper->curtain_show = 0;
+	anim_init(&helper->curtain_anim, 0.7,
+		  curtain_anim_frame, curtain_anim_done);
+
+	/* what maynard always had, until it says otherwise */
+	helper->slide_style.curve = SHELL_HELPER_CURVE_SPRING;
+	helper->slide_style.duration = 250;
+	helper->curtain_style.curve = SHELL_HELPER_CURVE_EASE_OUT;
+	helper->curtain_style.duration = 400;
 
+	helper->slides = g_hash_table_new(NULL, NULL);
 	wl_list_init(&helper->slide_list);
+	wl_list_init(&helper->slide_pool);
+	wl_list_init(&helper->resource_list);
+	wl_list_init(&helper->edge_list);
+	wl_list_init(&helper->batch_list);
 
 	helper->destroy_listener.notify = helper_destroy;
 	wl_signal_add(&ec->destroy_signal, &helper->destroy_listener);
 
-	if (wl_global_create(ec->wl_display, &shell_helper_interface, 1,
-			     helper, bind_helper) == NULL)
+	/* forward blanking so the client can stop its timers */
+	helper->idle_listener.notify = helper_idle;
+	wl_signal_add(&ec->idle_signal, &helper->idle_listener);
+	helper->wake_listener.notify = helper_wake;
+	wl_signal_add(&ec->wake_signal, &helper->wake_listener);
+
+	weston_compositor_add_button_binding(ec, BTN_LEFT, 0,
+					     curtain_button_binding, helper);
+	weston_compositor_add_modifier_binding(ec, MODIFIER_SUPER,
+					       launcher_modifier_binding,
+					       helper);
+	weston_compositor_add_touch_binding(ec, 0,
+					    swipe_touch_binding, helper);
+
+	/* watch every pointer for the edge zone */
+	helper->seat_created_listener.notify = edge_seat_created;
+	wl_signal_add(&ec->seat_created_signal,
+		      &helper->seat_created_listener);
+	wl_list_for_each(seat, &ec->seat_list, link)
+		edge_seat_created(&helper->seat_created_listener, seat);
+
+	if (wl_global_create(ec->wl_display, &shell_helper_interface,
+			     SHELL_HELPER_VERSION, helper, bind_helper) == NULL)
 		return -1;
 
 	return 0;
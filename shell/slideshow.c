@@ -0,0 +1,505 @@
+/*
+ * Copyright (C) 2014 Collabora Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#include "config.h"
+
+#include <gio/gio.h>
+
+#include "activity.h"
+#include "slideshow.h"
+#include "wallpaper.h"
+
+enum {
+  PROP_0,
+  PROP_WIDTH,
+  PROP_HEIGHT,
+  PROP_SCALE,
+  PROP_LOAD_TIME,
+};
+
+enum {
+  FRAME_READY,
+  N_SIGNALS
+};
+static guint signals[N_SIGNALS] = { 0 };
+
+/* rotates the wallpaper through the images listed in the slideshow
+ * setting. the next image is loaded on a worker thread half way
+ * through the interval, so apart from the short crossfade there are
+ * never more than two frames around: the one on screen and the one
+ * coming next. */
+struct MaynardSlideshowPrivate {
+  GSettings *settings;
+
+  gint width;
+  gint height;
+  gint scale;
+
+  gchar **images;
+  guint n_images;
+  guint index;
+  guint interval;
+
+  GCancellable *cancellable;
+  gboolean first; /* the next frame is the first one shown */
+  guint failures; /* images in a row which could not be loaded */
+  cairo_surface_t *next;
+  gboolean switch_due;
+
+  guint switch_id;
+  guint prefetch_id;
+
+  gint64 load_time;
+};
+
+G_DEFINE_TYPE(MaynardSlideshow, maynard_slideshow, G_TYPE_OBJECT)
+
+static void load (MaynardSlideshow *self);
+
+static void
+maynard_slideshow_init (MaynardSlideshow *self)
+{
+  self->priv = G_TYPE_INSTANCE_GET_PRIVATE (self,
+      MAYNARD_SLIDESHOW_TYPE,
+      MaynardSlideshowPrivate);
+
+  self->priv->scale = 1;
+}
+
+static gint
+compare_strings (gconstpointer a,
+    gconstpointer b)
+{
+  return g_strcmp0 (*(const gchar **) a, *(const gchar **) b);
+}
+
+/* every entry is either an image or a directory of images; the
+ * contents of a directory are shown in name order. with none of
+ * them, MAYNARD_BACKGROUND is the only image. */
+static void
+update_images (MaynardSlideshow *self)
+{
+  GPtrArray *images;
+  gchar **entries;
+  const gchar *background;
+  guint i, j;
+
+  entries = g_settings_get_strv (self->priv->settings, "slideshow");
+  images = g_ptr_array_new ();
+
+  for (i = 0; entries[i] != NULL; i++)
+    {
+      GPtrArray *files;
+      const gchar *name;
+      GDir *dir;
+
+      if (!g_file_test (entries[i], G_FILE_TEST_IS_DIR))
+        {
+          if (g_file_test (entries[i], G_FILE_TEST_IS_REGULAR))
+            g_ptr_array_add (images, g_strdup (entries[i]));
+          continue;
+        }
+
+      dir = g_dir_open (entries[i], 0, NULL);
+      if (dir == NULL)
+        continue;
+
+      files = g_ptr_array_new ();
+      while ((name = g_dir_read_name (dir)) != NULL)
+        {
+          gchar *path;
+
+          if (name[0] == '.')
+            continue;
+
+          path = g_build_filename (entries[i], name, NULL);
+          if (g_file_test (path, G_FILE_TEST_IS_REGULAR))
+            g_ptr_array_add (files, path);
+          else
+            g_free (path);
+        }
+      g_dir_close (dir);
+
+      g_ptr_array_sort (files, compare_strings);
+      for (j = 0; j < files->len; j++)
+        g_ptr_array_add (images, g_ptr_array_index (files, j));
+      g_ptr_array_free (files, TRUE);
+    }
+
+  background = g_getenv ("MAYNARD_BACKGROUND");
+  if (images->len == 0 && background != NULL && background[0] != '\0')
+    g_ptr_array_add (images, g_strdup (background));
+
+  g_ptr_array_add (images, NULL);
+
+  g_strfreev (self->priv->images);
+  self->priv->n_images = images->len - 1;
+  self->priv->images = (gchar **) g_ptr_array_free (images, FALSE);
+
+  g_strfreev (entries);
+}
+
+static void
+stop (MaynardSlideshow *self)
+{
+  if (self->priv->cancellable != NULL)
+    {
+      g_cancellable_cancel (self->priv->cancellable);
+      g_clear_object (&self->priv->cancellable);
+    }
+
+  if (self->priv->switch_id > 0)
+    {
+      g_source_remove (self->priv->switch_id);
+      self->priv->switch_id = 0;
+    }
+
+  if (self->priv->prefetch_id > 0)
+    {
+      g_source_remove (self->priv->prefetch_id);
+      self->priv->prefetch_id = 0;
+    }
+
+  if (self->priv->next != NULL)
+    {
+      cairo_surface_destroy (self->priv->next);
+      self->priv->next = NULL;
+    }
+
+  self->priv->switch_due = FALSE;
+}
+
+static gboolean
+prefetch_cb (gpointer data)
+{
+  MaynardSlideshow *self = data;
+
+  self->priv->prefetch_id = 0;
+
+  self->priv->index = (self->priv->index + 1) % self->priv->n_images;
+  load (self);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+maybe_switch (MaynardSlideshow *self)
+{
+  cairo_surface_t *frame;
+
+  /* nobody would see the crossfade, wait until the output is back */
+  if (!self->priv->switch_due || self->priv->next == NULL
+      || !maynard_activity_is_active (maynard_activity_get_default ()))
+    return;
+
+  frame = self->priv->next;
+  self->priv->next = NULL;
+  self->priv->switch_due = FALSE;
+
+  g_signal_emit (self, signals[FRAME_READY], 0, frame, FALSE);
+  cairo_surface_destroy (frame);
+
+  self->priv->prefetch_id = g_timeout_add_seconds (
+      self->priv->interval / 2, prefetch_cb, self);
+}
+
+static gboolean
+switch_cb (gpointer data)
+{
+  MaynardSlideshow *self = data;
+
+  self->priv->switch_due = TRUE;
+  maybe_switch (self);
+
+  return G_SOURCE_CONTINUE;
+}
+
+static void
+loaded_cb (GObject *source_object,
+    GAsyncResult *result,
+    gpointer data)
+{
+  MaynardSlideshow *self = data;
+  cairo_surface_t *frame;
+  GError *error = NULL;
+  gint64 load_time;
+
+  frame = maynard_wallpaper_load_finish (result, &load_time, &error);
+
+  if (frame == NULL)
+    {
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        {
+          g_message ("Could not load slideshow image %s: %s",
+              self->priv->images[self->priv->index], error->message);
+
+          /* try the one after it. when none of them work, go round
+           * again after an interval, in case they get fixed. */
+          if (++self->priv->failures < self->priv->n_images)
+            {
+              prefetch_cb (self);
+            }
+          else
+            {
+              self->priv->failures = 0;
+              self->priv->prefetch_id = g_timeout_add_seconds (
+                  self->priv->interval, prefetch_cb, self);
+            }
+        }
+
+      g_clear_error (&error);
+      g_object_unref (self);
+      return;
+    }
+
+  self->priv->failures = 0;
+  self->priv->load_time = load_time;
+  g_object_notify (G_OBJECT (self), "load-time");
+
+  if (self->priv->first)
+    {
+      self->priv->first = FALSE;
+      g_signal_emit (self, signals[FRAME_READY], 0, frame, TRUE);
+      cairo_surface_destroy (frame);
+
+      if (self->priv->n_images > 1)
+        {
+          self->priv->switch_id = g_timeout_add_seconds (
+              self->priv->interval, switch_cb, self);
+          self->priv->prefetch_id = g_timeout_add_seconds (
+              self->priv->interval / 2, prefetch_cb, self);
+        }
+    }
+  else
+    {
+      self->priv->next = frame;
+      maybe_switch (self);
+    }
+
+  g_object_unref (self);
+}
+
+static void
+load (MaynardSlideshow *self)
+{
+  if (self->priv->cancellable == NULL)
+    self->priv->cancellable = g_cancellable_new ();
+
+  maynard_wallpaper_load_async (self->priv->images[self->priv->index],
+      self->priv->width, self->priv->height, self->priv->scale,
+      self->priv->cancellable, loaded_cb, g_object_ref (self));
+}
+
+static void
+settings_changed_cb (GSettings *settings,
+    const gchar *key,
+    MaynardSlideshow *self)
+{
+  stop (self);
+
+  self->priv->interval = g_settings_get_uint (settings,
+      "slideshow-interval");
+  update_images (self);
+
+  maynard_slideshow_start (self);
+}
+
+static void
+activity_notify_cb (MaynardActivity *activity,
+    GParamSpec *pspec,
+    MaynardSlideshow *self)
+{
+  maybe_switch (self);
+}
+
+static void
+maynard_slideshow_constructed (GObject *object)
+{
+  MaynardSlideshow *self = MAYNARD_SLIDESHOW (object);
+
+  G_OBJECT_CLASS (maynard_slideshow_parent_class)->constructed (object);
+
+  self->priv->settings = g_settings_new ("org.raspberrypi.maynard");
+  self->priv->interval = g_settings_get_uint (self->priv->settings,
+      "slideshow-interval");
+  update_images (self);
+
+  g_signal_connect (self->priv->settings, "changed::slideshow",
+      G_CALLBACK (settings_changed_cb), self);
+  g_signal_connect (self->priv->settings, "changed::slideshow-interval",
+      G_CALLBACK (settings_changed_cb), self);
+
+  g_signal_connect (maynard_activity_get_default (), "notify::active",
+      G_CALLBACK (activity_notify_cb), self);
+}
+
+static void
+maynard_slideshow_dispose (GObject *object)
+{
+  MaynardSlideshow *self = MAYNARD_SLIDESHOW (object);
+
+  stop (self);
+
+  g_signal_handlers_disconnect_by_func (maynard_activity_get_default (),
+      activity_notify_cb, self);
+  g_clear_object (&self->priv->settings);
+
+  G_OBJECT_CLASS (maynard_slideshow_parent_class)->dispose (object);
+}
+
+static void
+maynard_slideshow_finalize (GObject *object)
+{
+  MaynardSlideshow *self = MAYNARD_SLIDESHOW (object);
+
+  g_strfreev (self->priv->images);
+
+  G_OBJECT_CLASS (maynard_slideshow_parent_class)->finalize (object);
+}
+
+static void
+maynard_slideshow_get_property (GObject *object,
+    guint param_id,
+    GValue *value,
+    GParamSpec *pspec)
+{
+  MaynardSlideshow *self = MAYNARD_SLIDESHOW (object);
+
+  switch (param_id)
+    {
+      case PROP_WIDTH:
+        g_value_set_int (value, self->priv->width);
+        break;
+      case PROP_HEIGHT:
+        g_value_set_int (value, self->priv->height);
+        break;
+      case PROP_SCALE:
+        g_value_set_int (value, self->priv->scale);
+        break;
+      case PROP_LOAD_TIME:
+        g_value_set_int64 (value, self->priv->load_time);
+        break;
+      default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID (object, param_id, pspec);
+        break;
+    }
+}
+
+static void
+maynard_slideshow_set_property (GObject *object,
+    guint param_id,
+    const GValue *value,
+    GParamSpec *pspec)
+{
+  MaynardSlideshow *self = MAYNARD_SLIDESHOW (object);
+
+  switch (param_id)
+    {
+      case PROP_WIDTH:
+        self->priv->width = g_value_get_int (value);
+        break;
+      case PROP_HEIGHT:
+        self->priv->height = g_value_get_int (value);
+        break;
+      case PROP_SCALE:
+        self->priv->scale = g_value_get_int (value);
+        break;
+      default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID (object, param_id, pspec);
+        break;
+    }
+}
+
+static void
+maynard_slideshow_class_init (MaynardSlideshowClass *klass)
+{
+  GObjectClass *object_class = (GObjectClass *)klass;
+
+  object_class->constructed = maynard_slideshow_constructed;
+  object_class->dispose = maynard_slideshow_dispose;
+  object_class->finalize = maynard_slideshow_finalize;
+  object_class->get_property = maynard_slideshow_get_property;
+  object_class->set_property = maynard_slideshow_set_property;
+
+  g_object_class_install_property (object_class, PROP_WIDTH,
+      g_param_spec_int ("width",
+          "width",
+          "Width of the output in logical pixels",
+          1, G_MAXINT, 1,
+          G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY |
+          G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (object_class, PROP_HEIGHT,
+      g_param_spec_int ("height",
+          "height",
+          "Height of the output in logical pixels",
+          1, G_MAXINT, 1,
+          G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY |
+          G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (object_class, PROP_SCALE,
+      g_param_spec_int ("scale",
+          "scale",
+          "Scale factor of the output",
+          1, G_MAXINT, 1,
+          G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY |
+          G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (object_class, PROP_LOAD_TIME,
+      g_param_spec_int64 ("load-time",
+          "load-time",
+          "Microseconds spent decoding and scaling the last image",
+          0, G_MAXINT64, 0,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  /* the frame is only borrowed for the emission; handlers must take
+   * their own reference. first is TRUE when nothing was shown yet, so
+   * there is nothing to crossfade from. */
+  signals[FRAME_READY] = g_signal_new ("frame-ready",
+      G_TYPE_FROM_CLASS (klass), G_SIGNAL_RUN_LAST, 0, NULL, NULL,
+      NULL, G_TYPE_NONE, 2, G_TYPE_POINTER, G_TYPE_BOOLEAN);
+
+  g_type_class_add_private (object_class, sizeof (MaynardSlideshowPrivate));
+}
+
+MaynardSlideshow *
+maynard_slideshow_new (gint width,
+    gint height,
+    gint scale)
+{
+  return g_object_new (MAYNARD_SLIDESHOW_TYPE,
+      "width", width,
+      "height", height,
+      "scale", scale,
+      NULL);
+}
+
+/* loads the first image straight away; it is announced with
+ * ::frame-ready like all the following ones */
+void
+maynard_slideshow_start (MaynardSlideshow *self)
+{
+  if (self->priv->n_images == 0)
+    return;
+
+  self->priv->index = 0;
+  self->priv->failures = 0;
+  self->priv->first = TRUE;
+  load (self);
+}
@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2014 Collabora Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#ifndef __MAYNARD_SLIDESHOW_H__
+#define __MAYNARD_SLIDESHOW_H__
+
+#include <glib-object.h>
+
+#define MAYNARD_SLIDESHOW_TYPE                 (maynard_slideshow_get_type ())
+#define MAYNARD_SLIDESHOW(obj)                 (G_TYPE_CHECK_INSTANCE_CAST ((obj), MAYNARD_SLIDESHOW_TYPE, MaynardSlideshow))
+#define MAYNARD_SLIDESHOW_CLASS(klass)         (G_TYPE_CHECK_CLASS_CAST ((klass), MAYNARD_SLIDESHOW_TYPE, MaynardSlideshowClass))
+#define MAYNARD_IS_SLIDESHOW(obj)              (G_TYPE_CHECK_INSTANCE_TYPE ((obj), MAYNARD_SLIDESHOW_TYPE))
+#define MAYNARD_IS_SLIDESHOW_CLASS(klass)      (G_TYPE_CHECK_CLASS_TYPE ((klass), MAYNARD_SLIDESHOW_TYPE))
+#define MAYNARD_SLIDESHOW_GET_CLASS(obj)       (G_TYPE_INSTANCE_GET_CLASS ((obj), MAYNARD_SLIDESHOW_TYPE, MaynardSlideshowClass))
+
+typedef struct MaynardSlideshow MaynardSlideshow;
+typedef struct MaynardSlideshowClass MaynardSlideshowClass;
+typedef struct MaynardSlideshowPrivate MaynardSlideshowPrivate;
+
+struct MaynardSlideshow
+{
+  GObject parent;
+
+  MaynardSlideshowPrivate *priv;
+};
+
+struct MaynardSlideshowClass
+{
+  GObjectClass parent_class;
+};
+
+GType maynard_slideshow_get_type (void) G_GNUC_CONST;
+
+MaynardSlideshow * maynard_slideshow_new (gint width, gint height,
+    gint scale);
+
+void maynard_slideshow_start (MaynardSlideshow *self);
+
+#endif /* __MAYNARD_SLIDESHOW_H__ */
@@ -0,0 +1,257 @@
+/*
+ * Copyright (C) 2014 Collabora Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <glib-unix.h>
+
+#ifdef HAVE_SYSPROF
+#include <sysprof-capture.h>
+#endif
+
+#include "trace.h"
+
+typedef struct {
+  const gchar *name; /* always a literal */
+  gint64 begin, end; /* equal for marks */
+} TraceEvent;
+
+typedef struct {
+  const gchar *name; /* always a literal */
+  guint count;
+  gint64 total, worst;
+  gint64 last;
+} TraceLatency;
+
+static gint64 start_time;
+static GArray *events; /* TraceEvent, or NULL when not tracing */
+static GArray *latencies; /* TraceLatency, in the order first seen */
+
+static gboolean
+latency_signal_cb (gpointer data)
+{
+  maynard_trace_latency_report ();
+
+  return G_SOURCE_CONTINUE;
+}
+
+void
+maynard_trace_init (void)
+{
+  start_time = g_get_monotonic_time ();
+
+  events = g_array_new (FALSE, FALSE, sizeof (TraceEvent));
+
+  latencies = g_array_new (FALSE, FALSE, sizeof (TraceLatency));
+  g_unix_signal_add (SIGUSR1, latency_signal_cb, NULL);
+}
+
+gint64
+maynard_trace_begin (void)
+{
+  return g_get_monotonic_time ();
+}
+
+static void
+trace_add (const gchar *name,
+    gint64 begin,
+    gint64 end)
+{
+  TraceEvent event = { name, begin, end };
+
+#ifdef HAVE_SYSPROF
+  /* does nothing unless sysprof started us; it wants nanoseconds on
+   * the same monotonic clock */
+  sysprof_collector_mark (begin * 1000, (end - begin) * 1000,
+      "maynard", name, NULL);
+#endif
+
+  if (events != NULL)
+    g_array_append_val (events, event);
+}
+
+void
+maynard_trace_end (gint64 begin,
+    const gchar *phase)
+{
+  gint64 end = g_get_monotonic_time ();
+
+  g_debug ("startup: %s took %.1f ms, done after %.1f ms", phase,
+      (end - begin) / 1000.0, (end - start_time) / 1000.0);
+
+  trace_add (phase, begin, end);
+}
+
+void
+maynard_trace_mark (const gchar *event)
+{
+  gint64 now = g_get_monotonic_time ();
+
+  g_debug ("startup: %s after %.1f ms", event,
+      (now - start_time) / 1000.0);
+
+  trace_add (event, now, now);
+}
+
+void
+maynard_trace_latency (gint64 begin,
+    const gchar *name)
+{
+  gint64 end = g_get_monotonic_time ();
+  TraceLatency *latency = NULL;
+  guint i;
+
+  g_debug ("%s after %.1f ms", name, (end - begin) / 1000.0);
+
+#ifdef HAVE_SYSPROF
+  sysprof_collector_mark (begin * 1000, (end - begin) * 1000,
+      "maynard", name, NULL);
+#endif
+
+  for (i = 0; i < latencies->len; i++)
+    {
+      latency = &g_array_index (latencies, TraceLatency, i);
+      if (strcmp (latency->name, name) == 0)
+        break;
+    }
+
+  if (i == latencies->len)
+    {
+      TraceLatency new_latency = { name, 0, 0, 0, 0 };
+
+      g_array_append_val (latencies, new_latency);
+      latency = &g_array_index (latencies, TraceLatency, i);
+    }
+
+  latency->count++;
+  latency->total += end - begin;
+  latency->worst = MAX (latency->worst, end - begin);
+  latency->last = end - begin;
+}
+
+void
+maynard_trace_latency_report (void)
+{
+  guint i;
+
+  if (latencies->len == 0)
+    g_message ("no latencies recorded yet");
+
+  for (i = 0; i < latencies->len; i++)
+    {
+      TraceLatency *latency = &g_array_index (latencies, TraceLatency, i);
+
+      g_message ("%s: %u times, mean %.1f ms, worst %.1f ms, "
+          "last %.1f ms", latency->name, latency->count,
+          latency->total / 1000.0 / latency->count,
+          latency->worst / 1000.0, latency->last / 1000.0);
+    }
+}
+
+/* one line for the log, whether or not the JSON is wanted */
+static void
+trace_summary (void)
+{
+  GString *summary = g_string_new (NULL);
+  gint64 end = start_time;
+  guint i;
+
+  for (i = 0; i < events->len; i++)
+    {
+      TraceEvent *event = &g_array_index (events, TraceEvent, i);
+
+      if (event->begin == event->end)
+        g_string_append_printf (summary, "%s%s at %.1f ms",
+            i > 0 ? ", " : "", event->name,
+            (event->begin - start_time) / 1000.0);
+      else
+        g_string_append_printf (summary, "%s%s %.1f ms",
+            i > 0 ? ", " : "", event->name,
+            (event->end - event->begin) / 1000.0);
+
+      end = MAX (end, event->end);
+    }
+
+  g_message ("startup took %.1f ms: %s", (end - start_time) / 1000.0,
+      summary->str);
+
+  g_string_free (summary, TRUE);
+}
+
+static void
+trace_write (FILE *file)
+{
+  gint64 end = start_time;
+  guint i;
+
+  fprintf (file, "{\n  \"phases\": [\n");
+
+  for (i = 0; i < events->len; i++)
+    {
+      TraceEvent *event = &g_array_index (events, TraceEvent, i);
+
+      fprintf (file, "    { \"name\": \"%s\", \"start_ms\": %.3f, "
+          "\"duration_ms\": %.3f }%s\n", event->name,
+          (event->begin - start_time) / 1000.0,
+          (event->end - event->begin) / 1000.0,
+          i + 1 < events->len ? "," : "");
+
+      end = MAX (end, event->end);
+    }
+
+  fprintf (file, "  ],\n  \"total_ms\": %.3f\n}\n",
+      (end - start_time) / 1000.0);
+}
+
+void
+maynard_trace_report (void)
+{
+  const gchar *path = g_getenv ("MAYNARD_TRACE_STARTUP");
+  FILE *file = stderr;
+
+  if (events == NULL)
+    return;
+
+  trace_summary ();
+
+  if (path != NULL && strcmp (path, "1") != 0)
+    {
+      file = fopen (path, "w");
+      if (file == NULL)
+        {
+          g_warning ("Failed to write startup trace to %s: %s", path,
+              g_strerror (errno));
+          file = stderr;
+        }
+    }
+
+  if (path != NULL)
+    trace_write (file);
+
+  if (file != stderr)
+    fclose (file);
+
+  g_array_free (events, TRUE);
+  events = NULL;
+}
@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2014 Collabora Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#ifndef __MAYNARD_TRACE_H__
+#define __MAYNARD_TRACE_H__
+
+#include <glib.h>
+
+/* where startup time goes. every phase is logged with g_debug as it
+ * ends, and maynard_trace_report() logs them all on one line with
+ * g_message. with MAYNARD_TRACE_STARTUP set it also writes them out
+ * as JSON, to the file the variable names or to stderr if it is "1".
+ * built with sysprof-capture, they show up as marks when maynard runs
+ * under sysprof.
+ *
+ *   gint64 begin = maynard_trace_begin ();
+ *   ...
+ *   maynard_trace_end (begin, "css");
+ */
+
+void maynard_trace_init (void);
+
+gint64 maynard_trace_begin (void);
+void maynard_trace_end (gint64 begin, const gchar *phase);
+
+/* something which happens at one point in time rather than taking
+ * any, like desktop_ready being sent */
+void maynard_trace_mark (const gchar *event);
+
+/* startup is over; anything traced after this is only logged */
+void maynard_trace_report (void);
+
+/* a delay which keeps coming back while maynard runs, like the panel
+ * starting to slide after the pointer entered it. every one is a
+ * sysprof mark; how many there were, their mean, the worst and the
+ * last are kept per name and logged by maynard_trace_latency_report(),
+ * which sending maynard SIGUSR1 also runs. begin is on the
+ * g_get_monotonic_time() clock and the latency ends now. */
+void maynard_trace_latency (gint64 begin, const gchar *name);
+void maynard_trace_latency_report (void);
+
+#endif /* __MAYNARD_TRACE_H__ */
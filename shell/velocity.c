@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2014 Collabora Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#include "config.h"
+
+#include "velocity.h"
+
+/* only the movement this recent counts, so a finger which stopped
+ * before letting go has no speed left */
+#define WINDOW_MS 100
+
+void
+maynard_velocity_reset (MaynardVelocity *self)
+{
+  self->next = 0;
+  self->n_samples = 0;
+}
+
+void
+maynard_velocity_add (MaynardVelocity *self,
+    guint32 time,
+    gdouble x,
+    gdouble y)
+{
+  MaynardVelocitySample *sample = &self->samples[self->next];
+
+  sample->time = time;
+  sample->x = x;
+  sample->y = y;
+
+  self->next = (self->next + 1) % MAYNARD_VELOCITY_SAMPLES;
+  if (self->n_samples < MAYNARD_VELOCITY_SAMPLES)
+    self->n_samples++;
+}
+
+/* a least squares fit of position against time over the window,
+ * which is far less jumpy than the last two events on their own */
+void
+maynard_velocity_get (MaynardVelocity *self,
+    gdouble *vx,
+    gdouble *vy)
+{
+  const MaynardVelocitySample *latest;
+  gdouble st = 0, sx = 0, sy = 0, stt = 0, stx = 0, sty = 0;
+  gdouble denominator;
+  guint i, n = 0;
+
+  *vx = 0;
+  *vy = 0;
+
+  if (self->n_samples < 2)
+    return;
+
+  latest = &self->samples[(self->next + MAYNARD_VELOCITY_SAMPLES - 1)
+      % MAYNARD_VELOCITY_SAMPLES];
+
+  for (i = 0; i < self->n_samples; i++)
+    {
+      const MaynardVelocitySample *sample = &self->samples[
+          (self->next + MAYNARD_VELOCITY_SAMPLES - 1 - i)
+          % MAYNARD_VELOCITY_SAMPLES];
+      /* the clock wraps, the difference does not */
+      gdouble t = -(gdouble) (guint32) (latest->time - sample->time);
+
+      if (t < -WINDOW_MS)
+        break;
+
+      st += t;
+      sx += sample->x;
+      sy += sample->y;
+      stt += t * t;
+      stx += t * sample->x;
+      sty += t * sample->y;
+      n++;
+    }
+
+  denominator = n * stt - st * st;
+  if (n < 2 || denominator <= 0)
+    return;
+
+  *vx = (n * stx - st * sx) / denominator;
+  *vy = (n * sty - st * sy) / denominator;
+}
@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2014 Collabora Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#ifndef __MAYNARD_VELOCITY_H__
+#define __MAYNARD_VELOCITY_H__
+
+#include <glib.h>
+
+/* how fast a finger is moving, from the timestamps of its last few
+ * positions. shared between the shell and the helper module, so it
+ * only needs glib. */
+
+#define MAYNARD_VELOCITY_SAMPLES 16
+
+typedef struct {
+  guint32 time; /* ms, as in the input events */
+  gdouble x, y;
+} MaynardVelocitySample;
+
+typedef struct {
+  MaynardVelocitySample samples[MAYNARD_VELOCITY_SAMPLES];
+  guint next;
+  guint n_samples;
+} MaynardVelocity;
+
+void maynard_velocity_reset (MaynardVelocity *self);
+
+void maynard_velocity_add (MaynardVelocity *self,
+    guint32 time, gdouble x, gdouble y);
+
+/* in pixels per ms */
+void maynard_velocity_get (MaynardVelocity *self,
+    gdouble *vx, gdouble *vy);
+
+#endif /* __MAYNARD_VELOCITY_H__ */
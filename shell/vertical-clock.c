@@ -26,20 +26,29 @@
 #define GNOME_DESKTOP_USE_UNSTABLE_API
 #include <libgnome-desktop/gnome-wall-clock.h>
 
+#include "activity.h"
 #include "panel.h"
 
+enum {
+  PROP_0,
+  PROP_EDGE,
+};
+
 struct MaynardVerticalClockPrivate {
+  MaynardLayoutEdge edge;
   GtkWidget *label;
 
   GnomeWallClock *wall_clock;
+  gint64 wall_clock_stopped_time;
 };
 
 G_DEFINE_TYPE(MaynardVerticalClock, maynard_vertical_clock, GTK_TYPE_BOX)
 
 /* this widget takes up the entire width of the panel and displays
- * padding for the first (panel width - vertical clock width) pixels,
- * then shows the vertical clock itself. the idea is to put this into
- * a GtkRevealer and only show it when appropriate. */
+ * padding for the first (panel width - vertical clock width) pixels
+ * from the edge, then shows the vertical clock itself. the idea is to
+ * put this into a GtkRevealer and only show it when appropriate. on
+ * a horizontal panel the clock is a single line. */
 
 static void
 maynard_vertical_clock_init (MaynardVerticalClock *self)
@@ -59,30 +68,71 @@ wall_clock_notify_cb (GnomeWallClock *wall_clock,
 
   datetime = g_date_time_new_now_local ();
 
-  str = g_date_time_format (datetime,
-      "<span font=\"Droid Sans 12\">%H\n"
-      ":\n"
-      "%M</span>");
+  if (maynard_layout_get_orientation (self->priv->edge)
+      == GTK_ORIENTATION_VERTICAL)
+    str = g_date_time_format (datetime,
+        "<span font=\"Droid Sans 12\">%H\n"
+        ":\n"
+        "%M</span>");
+  else
+    str = g_date_time_format (datetime,
+        "<span font=\"Droid Sans 12\">%H:%M</span>");
   gtk_label_set_markup (GTK_LABEL (self->priv->label), str);
 
   g_free (str);
   g_date_time_unref (datetime);
 }
 
+static void
+wall_clock_start (MaynardVerticalClock *self)
+{
+  self->priv->wall_clock = g_object_new (GNOME_TYPE_WALL_CLOCK, NULL);
+  g_signal_connect (self->priv->wall_clock, "notify::clock",
+      G_CALLBACK (wall_clock_notify_cb), self);
+}
+
+static void
+activity_notify_cb (MaynardActivity *activity,
+    GParamSpec *pspec,
+    MaynardVerticalClock *self)
+{
+  if (!maynard_activity_is_active (activity))
+    {
+      g_clear_object (&self->priv->wall_clock);
+      self->priv->wall_clock_stopped_time = g_get_monotonic_time ();
+      return;
+    }
+
+  if (self->priv->wall_clock != NULL)
+    return;
+
+  maynard_activity_add_avoided_wakeups (activity,
+      (g_get_monotonic_time () - self->priv->wall_clock_stopped_time)
+      / (60 * G_USEC_PER_SEC));
+
+  wall_clock_start (self);
+  wall_clock_notify_cb (self->priv->wall_clock, NULL, self);
+}
+
 static void
 maynard_vertical_clock_constructed (GObject *object)
 {
   MaynardVerticalClock *self = MAYNARD_VERTICAL_CLOCK (object);
   GtkWidget *padding;
+  gboolean vertical;
   gint width;
 
   G_OBJECT_CLASS (maynard_vertical_clock_parent_class)->constructed (object);
 
-  self->priv->wall_clock = g_object_new (GNOME_TYPE_WALL_CLOCK, NULL);
-  g_signal_connect (self->priv->wall_clock, "notify::clock",
-      G_CALLBACK (wall_clock_notify_cb), self);
+  wall_clock_start (self);
+  g_signal_connect (maynard_activity_get_default (), "notify::active",
+      G_CALLBACK (activity_notify_cb), self);
 
-  gtk_orientable_set_orientation (GTK_ORIENTABLE (self), GTK_ORIENTATION_HORIZONTAL);
+  /* across the panel */
+  vertical = maynard_layout_get_orientation (self->priv->edge)
+    == GTK_ORIENTATION_VERTICAL;
+  gtk_orientable_set_orientation (GTK_ORIENTABLE (self),
+      vertical ? GTK_ORIENTATION_HORIZONTAL : GTK_ORIENTATION_VERTICAL);
 
   /* a label just to pad things out to the correct width */
   width = MAYNARD_PANEL_WIDTH - MAYNARD_VERTICAL_CLOCK_WIDTH;
@@ -90,17 +140,36 @@ maynard_vertical_clock_constructed (GObject *object)
   padding = gtk_label_new ("");
   gtk_style_context_add_class (gtk_widget_get_style_context (padding),
       "maynard-clock");
-  gtk_widget_set_size_request (padding, width, -1);
-  gtk_box_pack_start (GTK_BOX (self), padding, FALSE, FALSE, 0);
+  if (vertical)
+    gtk_widget_set_size_request (padding, width, -1);
+  else
+    gtk_widget_set_size_request (padding, -1, width);
 
   /* the actual clock label */
   self->priv->label = gtk_label_new ("");
   gtk_style_context_add_class (gtk_widget_get_style_context (self->priv->label),
       "maynard-clock");
   gtk_label_set_justify (GTK_LABEL (self->priv->label), GTK_JUSTIFY_CENTER);
-  gtk_widget_set_size_request (self->priv->label,
-      MAYNARD_VERTICAL_CLOCK_WIDTH, -1);
-  gtk_box_pack_start (GTK_BOX (self), self->priv->label, FALSE, FALSE, 0);
+  if (vertical)
+    gtk_widget_set_size_request (self->priv->label,
+        MAYNARD_VERTICAL_CLOCK_WIDTH, -1);
+  else
+    gtk_widget_set_size_request (self->priv->label,
+        -1, MAYNARD_VERTICAL_CLOCK_WIDTH);
+
+  /* the padding goes on the edge side, so the clock is what stays
+   * on the output once the panel slid away */
+  if (self->priv->edge == MAYNARD_LAYOUT_EDGE_LEFT
+      || self->priv->edge == MAYNARD_LAYOUT_EDGE_TOP)
+    {
+      gtk_box_pack_start (GTK_BOX (self), padding, FALSE, FALSE, 0);
+      gtk_box_pack_start (GTK_BOX (self), self->priv->label, FALSE, FALSE, 0);
+    }
+  else
+    {
+      gtk_box_pack_start (GTK_BOX (self), self->priv->label, FALSE, FALSE, 0);
+      gtk_box_pack_start (GTK_BOX (self), padding, FALSE, FALSE, 0);
+    }
 
   wall_clock_notify_cb (self->priv->wall_clock, NULL, self);
 }
@@ -110,9 +179,51 @@ maynard_vertical_clock_dispose (GObject *object)
 {
   MaynardVerticalClock *self = MAYNARD_VERTICAL_CLOCK (object);
 
+  g_signal_handlers_disconnect_by_func (maynard_activity_get_default (),
+      activity_notify_cb, self);
+  g_clear_object (&self->priv->wall_clock);
+
   G_OBJECT_CLASS (maynard_vertical_clock_parent_class)->dispose (object);
 }
 
+static void
+maynard_vertical_clock_get_property (GObject *object,
+    guint param_id,
+    GValue *value,
+    GParamSpec *pspec)
+{
+  MaynardVerticalClock *self = MAYNARD_VERTICAL_CLOCK (object);
+
+  switch (param_id)
+    {
+      case PROP_EDGE:
+        g_value_set_int (value, self->priv->edge);
+        break;
+      default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID (object, param_id, pspec);
+        break;
+    }
+}
+
+static void
+maynard_vertical_clock_set_property (GObject *object,
+    guint param_id,
+    const GValue *value,
+    GParamSpec *pspec)
+{
+  MaynardVerticalClock *self = MAYNARD_VERTICAL_CLOCK (object);
+
+  switch (param_id)
+    {
+      case PROP_EDGE:
+        self->priv->edge = g_value_get_int (value);
+        break;
+      default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID (object, param_id, pspec);
+        break;
+    }
+}
+
 static void
 maynard_vertical_clock_class_init (MaynardVerticalClockClass *klass)
 {
@@ -120,13 +231,24 @@ maynard_vertical_clock_class_init (MaynardVerticalClockClass *klass)
 
   object_class->constructed = maynard_vertical_clock_constructed;
   object_class->dispose = maynard_vertical_clock_dispose;
+  object_class->get_property = maynard_vertical_clock_get_property;
+  object_class->set_property = maynard_vertical_clock_set_property;
+
+  g_object_class_install_property (object_class, PROP_EDGE,
+      g_param_spec_int ("edge",
+          "edge",
+          "The #MaynardLayoutEdge the panel is on",
+          MAYNARD_LAYOUT_EDGE_LEFT, MAYNARD_LAYOUT_EDGE_BOTTOM,
+          MAYNARD_LAYOUT_EDGE_LEFT,
+          G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY | G_PARAM_STATIC_STRINGS));
 
   g_type_class_add_private (object_class, sizeof (MaynardVerticalClockPrivate));
 }
 
 GtkWidget *
-maynard_vertical_clock_new (void)
+maynard_vertical_clock_new (MaynardLayoutEdge edge)
 {
   return g_object_new (MAYNARD_VERTICAL_CLOCK_TYPE,
+      "edge", edge,
       NULL);
 }
@@ -24,6 +24,8 @@
 
 #include <gtk/gtk.h>
 
+#include "layout.h"
+
 #define MAYNARD_VERTICAL_CLOCK_TYPE                 (maynard_vertical_clock_get_type ())
 #define MAYNARD_VERTICAL_CLOCK(obj)                 (G_TYPE_CHECK_INSTANCE_CAST ((obj), MAYNARD_VERTICAL_CLOCK_TYPE, MaynardVerticalClock))
 #define MAYNARD_VERTICAL_CLOCK_CLASS(klass)         (G_TYPE_CHECK_CLASS_CAST ((klass), MAYNARD_VERTICAL_CLOCK_TYPE, MaynardVerticalClockClass))
@@ -51,6 +53,6 @@ struct MaynardVerticalClockClass
 
 GType maynard_vertical_clock_get_type (void) G_GNUC_CONST;
 
-GtkWidget * maynard_vertical_clock_new (void);
+GtkWidget * maynard_vertical_clock_new (MaynardLayoutEdge edge);
 
 #endif /* __MAYNARD_VERTICAL_CLOCK_H__ */
@@ -0,0 +1,580 @@
+/*
+ * Copyright (C) 2014 Collabora Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <math.h>
+#include <string.h>
+
+#include <glib/gstdio.h>
+
+#include "scaler.h"
+#include "wallpaper.h"
+
+/* the wallpaper is decoded on a worker thread and scaled to the size
+ * it will be drawn at. a jpeg is asked for a power of two fraction of
+ * its size, which libjpeg produces with DCT scaling, so a large photo
+ * is never fully decoded in memory. everything else is done by our
+ * own scaler, in the quality picked in GSettings.
+ *
+ * the result is kept in the user cache directory exactly as cairo
+ * wants it: premultiplied, stride-aligned and cropped to the output.
+ * the file name is a hash of the source path, its mtime, the output
+ * size and the scale, so on the next start the file is just mapped
+ * and handed to cairo without decoding or scaling anything. */
+
+#define CACHE_MAGIC 0x4d594e57 /* "MYNW" */
+#define CACHE_VERSION 1
+
+/* padded so the pixel data after it stays 16 byte aligned */
+typedef struct {
+  guint32 magic;
+  guint32 version;
+  guint32 format;
+  guint32 width;
+  guint32 height;
+  guint32 stride;
+  guint32 padding[2];
+} CacheHeader;
+
+/* enough for a small slideshow to never decode twice */
+#define CACHE_MAX_ENTRIES 16
+
+typedef struct {
+  gchar *filename;
+  gint width;
+  gint height;
+  gint scale;
+  MaynardScalerQuality quality;
+
+  gint64 load_time;
+} LoadData;
+
+static cairo_user_data_key_t cache_key;
+
+static void
+load_data_free (gpointer data)
+{
+  LoadData *load = data;
+
+  g_free (load->filename);
+  g_slice_free (LoadData, load);
+}
+
+static gchar *
+cache_dir (void)
+{
+  return g_build_filename (g_get_user_cache_dir (), "maynard", NULL);
+}
+
+static gchar *
+cache_path (LoadData *load,
+    GStatBuf *st)
+{
+  gchar *key, *hash, *basename, *dir, *path;
+
+  key = g_strdup_printf ("%s\n%" G_GINT64_FORMAT "\n%d\n%d\n%d\n%d",
+      load->filename, (gint64) st->st_mtime,
+      load->width, load->height, load->scale, load->quality);
+  hash = g_compute_checksum_for_string (G_CHECKSUM_SHA1, key, -1);
+
+  basename = g_strdup_printf ("wallpaper-%s.raw", hash);
+  dir = cache_dir ();
+  path = g_build_filename (dir, basename, NULL);
+
+  g_free (dir);
+  g_free (basename);
+  g_free (hash);
+  g_free (key);
+
+  return path;
+}
+
+static void
+surface_set_scale (cairo_surface_t *surface,
+    gint scale)
+{
+#if CAIRO_VERSION >= CAIRO_VERSION_ENCODE (1, 14, 0)
+  cairo_surface_set_device_scale (surface, scale, scale);
+#endif
+}
+
+static cairo_surface_t *
+cache_lookup (const gchar *path,
+    LoadData *load)
+{
+  GMappedFile *mapped;
+  const CacheHeader *header;
+  cairo_surface_t *surface;
+  gsize length;
+
+  mapped = g_mapped_file_new (path, FALSE, NULL);
+  if (mapped == NULL)
+    return NULL;
+
+  length = g_mapped_file_get_length (mapped);
+  header = (const CacheHeader *) g_mapped_file_get_contents (mapped);
+
+  if (length < sizeof *header
+      || header->magic != CACHE_MAGIC
+      || header->version != CACHE_VERSION
+      || header->width != (guint32) (load->width * load->scale)
+      || header->height != (guint32) (load->height * load->scale)
+      || (header->format != CAIRO_FORMAT_ARGB32
+          && header->format != CAIRO_FORMAT_RGB24)
+      || header->stride != (guint32) cairo_format_stride_for_width (
+          header->format, header->width)
+      || length != sizeof *header + (gsize) header->stride * header->height)
+    {
+      g_mapped_file_unref (mapped);
+      return NULL;
+    }
+
+  /* so cache_expire() treats it as recently used */
+  g_utime (path, NULL);
+
+  /* cairo only ever reads from a source surface, so the read-only
+   * mapping is fine. it stays alive as long as the surface does. */
+  surface = cairo_image_surface_create_for_data (
+      (guchar *) (header + 1), header->format,
+      header->width, header->height, header->stride);
+  cairo_surface_set_user_data (surface, &cache_key, mapped,
+      (cairo_destroy_func_t) g_mapped_file_unref);
+  surface_set_scale (surface, load->scale);
+
+  return surface;
+}
+
+typedef struct {
+  gchar *path;
+  gint64 mtime;
+} CacheEntry;
+
+static gint
+cache_entry_compare (gconstpointer a,
+    gconstpointer b)
+{
+  const CacheEntry *entry_a = a, *entry_b = b;
+
+  /* newest first */
+  if (entry_a->mtime == entry_b->mtime)
+    return 0;
+  return entry_a->mtime > entry_b->mtime ? -1 : 1;
+}
+
+/* keep the cache from growing forever: drop the least recently
+ * written entries until there is room for one more */
+static void
+cache_expire (void)
+{
+  GArray *entries;
+  gchar *dir;
+  const gchar *name;
+  GDir *gdir;
+  guint i;
+
+  dir = cache_dir ();
+  gdir = g_dir_open (dir, 0, NULL);
+
+  if (gdir == NULL)
+    {
+      g_free (dir);
+      return;
+    }
+
+  entries = g_array_new (FALSE, FALSE, sizeof (CacheEntry));
+
+  while ((name = g_dir_read_name (gdir)) != NULL)
+    {
+      CacheEntry entry;
+      GStatBuf st;
+
+      if (!g_str_has_prefix (name, "wallpaper-"))
+        continue;
+
+      entry.path = g_build_filename (dir, name, NULL);
+      entry.mtime = g_stat (entry.path, &st) == 0 ? st.st_mtime : 0;
+      g_array_append_val (entries, entry);
+    }
+
+  g_dir_close (gdir);
+  g_free (dir);
+
+  g_array_sort (entries, cache_entry_compare);
+
+  for (i = 0; i < entries->len; i++)
+    {
+      CacheEntry *entry = &g_array_index (entries, CacheEntry, i);
+
+      if (i >= CACHE_MAX_ENTRIES - 1)
+        g_unlink (entry->path);
+      g_free (entry->path);
+    }
+
+  g_array_free (entries, TRUE);
+}
+
+static void
+cache_store (const gchar *path,
+    const gchar *contents,
+    gsize length)
+{
+  GError *error = NULL;
+  gchar *dir;
+
+  dir = cache_dir ();
+  g_mkdir_with_parents (dir, 0700);
+  g_free (dir);
+
+  cache_expire ();
+
+  if (!g_file_set_contents (path, contents, length, &error))
+    {
+      g_debug ("could not cache wallpaper: %s", error->message);
+      g_clear_error (&error);
+    }
+}
+
+/* copy the top-left of pixbuf into data, premultiplied in the native
+ * endian 32-bit layout cairo uses */
+static void
+convert_pixbuf (GdkPixbuf *pixbuf,
+    guchar *data,
+    gint width,
+    gint height,
+    gint stride)
+{
+  const guchar *src_row = gdk_pixbuf_get_pixels (pixbuf);
+  gint src_stride = gdk_pixbuf_get_rowstride (pixbuf);
+  gint n_channels = gdk_pixbuf_get_n_channels (pixbuf);
+  gboolean has_alpha = gdk_pixbuf_get_has_alpha (pixbuf);
+  gint x, y;
+
+  for (y = 0; y < height; y++)
+    {
+      const guchar *src = src_row;
+      guint32 *dest = (guint32 *) data;
+
+      for (x = 0; x < width; x++)
+        {
+          guint r = src[0], g = src[1], b = src[2];
+          guint a = has_alpha ? src[3] : 0xff;
+
+          if (a != 0xff)
+            {
+              guint t;
+
+              /* (c * a + 127) / 255 without the division */
+              t = r * a + 0x80; r = (t + (t >> 8)) >> 8;
+              t = g * a + 0x80; g = (t + (t >> 8)) >> 8;
+              t = b * a + 0x80; b = (t + (t >> 8)) >> 8;
+            }
+
+          dest[x] = (a << 24) | (r << 16) | (g << 8) | b;
+          src += n_channels;
+        }
+
+      src_row += src_stride;
+      data += stride;
+    }
+}
+
+static void
+size_prepared_cb (GdkPixbufLoader *loader,
+    gint original_width,
+    gint original_height,
+    LoadData *load)
+{
+  GdkPixbufFormat *format = gdk_pixbuf_loader_get_format (loader);
+  gint width = load->width * load->scale;
+  gint height = load->height * load->scale;
+  gint denom;
+
+  /* other loaders decode at full size anyway and then scale with
+   * gdk-pixbuf, which our scaler does better */
+  if (format == NULL
+      || g_strcmp0 (gdk_pixbuf_format_get_name (format), "jpeg") != 0)
+    return;
+
+  /* libjpeg can only scale by 1/2, 1/4 and 1/8 in the DCT; asking for
+   * exactly that size means gdk-pixbuf has nothing left to scale */
+  for (denom = 8; denom > 1; denom /= 2)
+    {
+      if ((original_width + denom - 1) / denom >= width
+          && (original_height + denom - 1) / denom >= height)
+        break;
+    }
+
+  if (denom > 1)
+    gdk_pixbuf_loader_set_size (loader,
+        (original_width + denom - 1) / denom,
+        (original_height + denom - 1) / denom);
+}
+
+static GdkPixbuf *
+decode (LoadData *load,
+    GCancellable *cancellable,
+    GError **error)
+{
+  GdkPixbufLoader *loader;
+  GFile *file;
+  GFileInputStream *stream;
+  GdkPixbuf *pixbuf;
+  GError *read_error = NULL;
+  guchar buffer[64 * 1024];
+  gssize len;
+
+  file = g_file_new_for_path (load->filename);
+  stream = g_file_read (file, cancellable, error);
+  g_object_unref (file);
+
+  if (stream == NULL)
+    return NULL;
+
+  loader = gdk_pixbuf_loader_new ();
+  g_signal_connect (loader, "size-prepared",
+      G_CALLBACK (size_prepared_cb), load);
+
+  while ((len = g_input_stream_read (G_INPUT_STREAM (stream),
+              buffer, sizeof buffer, cancellable, &read_error)) > 0)
+    {
+      if (!gdk_pixbuf_loader_write (loader, buffer, len, &read_error))
+        break;
+    }
+
+  g_object_unref (stream);
+
+  if (read_error != NULL)
+    {
+      gdk_pixbuf_loader_close (loader, NULL);
+      g_object_unref (loader);
+      g_propagate_error (error, read_error);
+      return NULL;
+    }
+
+  if (!gdk_pixbuf_loader_close (loader, error))
+    {
+      g_object_unref (loader);
+      return NULL;
+    }
+
+  pixbuf = gdk_pixbuf_loader_get_pixbuf (loader);
+  if (pixbuf == NULL)
+    g_set_error (error, G_IO_ERROR, G_IO_ERROR_FAILED,
+        "No image data in %s", load->filename);
+  else
+    g_object_ref (pixbuf);
+
+  g_object_unref (loader);
+
+  return pixbuf;
+}
+
+/* the part of the decoded image which ends up on screen: the image is
+ * scaled to cover the output, so a bit on the right or on the bottom
+ * is cropped out when the aspect ratio is different */
+static void
+source_region (GdkPixbuf *pixbuf,
+    gint width,
+    gint height,
+    gint *region_width,
+    gint *region_height)
+{
+  gint pixbuf_width = gdk_pixbuf_get_width (pixbuf);
+  gint pixbuf_height = gdk_pixbuf_get_height (pixbuf);
+  gdouble ratio;
+
+  ratio = MAX ((gdouble) width / pixbuf_width,
+      (gdouble) height / pixbuf_height);
+
+  *region_width = MIN (pixbuf_width, (gint) ceil (width / ratio));
+  *region_height = MIN (pixbuf_height, (gint) ceil (height / ratio));
+}
+
+static void
+scale_pixbuf (LoadData *load,
+    GdkPixbuf *pixbuf,
+    guchar *data,
+    gint width,
+    gint height,
+    gint stride)
+{
+  gint region_width, region_height, region_stride;
+  guchar *region;
+
+  source_region (pixbuf, width, height, &region_width, &region_height);
+
+  if (region_width == width && region_height == height)
+    {
+      convert_pixbuf (pixbuf, data, width, height, stride);
+      return;
+    }
+
+  /* premultiply first, so filtering does not bleed the colour of
+   * transparent pixels into their neighbours */
+  region_stride = region_width * 4;
+  region = g_malloc ((gsize) region_stride * region_height);
+  convert_pixbuf (pixbuf, region, region_width, region_height,
+      region_stride);
+
+  maynard_scaler_scale (region, region_width, region_height, region_stride,
+      data, width, height, stride, load->quality);
+
+  g_free (region);
+}
+
+static void
+load_thread (GTask *task,
+    gpointer source_object,
+    gpointer task_data,
+    GCancellable *cancellable)
+{
+  LoadData *load = task_data;
+  GdkPixbuf *pixbuf;
+  cairo_surface_t *surface;
+  cairo_format_t format;
+  CacheHeader *header;
+  GError *error = NULL;
+  GStatBuf st;
+  gchar *path, *contents;
+  gint width, height, stride;
+  gsize length;
+  gint64 start = g_get_monotonic_time ();
+  gint64 decode_time;
+
+  if (g_stat (load->filename, &st) < 0)
+    {
+      int errsv = errno;
+
+      g_task_return_new_error (task, G_IO_ERROR,
+          g_io_error_from_errno (errsv),
+          "%s: %s", load->filename, g_strerror (errsv));
+      return;
+    }
+
+  path = cache_path (load, &st);
+
+  surface = cache_lookup (path, load);
+  if (surface != NULL)
+    {
+      load->load_time = g_get_monotonic_time () - start;
+      g_debug ("wallpaper mapped from %s in %" G_GINT64_FORMAT " us",
+          path, load->load_time);
+      g_free (path);
+      g_task_return_pointer (task, surface,
+          (GDestroyNotify) cairo_surface_destroy);
+      return;
+    }
+
+  pixbuf = decode (load, cancellable, &error);
+  if (pixbuf == NULL)
+    {
+      g_free (path);
+      g_task_return_error (task, error);
+      return;
+    }
+
+  decode_time = g_get_monotonic_time () - start;
+
+  width = load->width * load->scale;
+  height = load->height * load->scale;
+  format = gdk_pixbuf_get_has_alpha (pixbuf) ?
+      CAIRO_FORMAT_ARGB32 : CAIRO_FORMAT_RGB24;
+  stride = cairo_format_stride_for_width (format, width);
+
+  /* build the cache file in memory, the surface uses its pixel data */
+  length = sizeof *header + (gsize) stride * height;
+  contents = g_malloc0 (length);
+  header = (CacheHeader *) contents;
+  header->magic = CACHE_MAGIC;
+  header->version = CACHE_VERSION;
+  header->format = format;
+  header->width = width;
+  header->height = height;
+  header->stride = stride;
+
+  scale_pixbuf (load, pixbuf, (guchar *) (header + 1), width, height,
+      stride);
+
+  g_object_unref (pixbuf);
+
+  load->load_time = g_get_monotonic_time () - start;
+  g_debug ("wallpaper loaded from %s in %" G_GINT64_FORMAT " us "
+      "(%" G_GINT64_FORMAT " us decoding)",
+      load->filename, load->load_time, decode_time);
+
+  cache_store (path, contents, length);
+  g_free (path);
+
+  surface = cairo_image_surface_create_for_data ((guchar *) (header + 1),
+      format, width, height, stride);
+  cairo_surface_set_user_data (surface, &cache_key, contents, g_free);
+  surface_set_scale (surface, load->scale);
+
+  g_task_return_pointer (task, surface,
+      (GDestroyNotify) cairo_surface_destroy);
+}
+
+void
+maynard_wallpaper_load_async (const gchar *filename,
+    gint width,
+    gint height,
+    gint scale,
+    GCancellable *cancellable,
+    GAsyncReadyCallback callback,
+    gpointer user_data)
+{
+  GTask *task;
+  LoadData *load;
+  GSettings *settings;
+
+  load = g_slice_new0 (LoadData);
+  load->filename = g_strdup (filename);
+  load->width = width;
+  load->height = height;
+  load->scale = MAX (scale, 1);
+
+  settings = g_settings_new ("org.raspberrypi.maynard");
+  load->quality = g_settings_get_enum (settings, "wallpaper-quality");
+  g_object_unref (settings);
+
+  task = g_task_new (NULL, cancellable, callback, user_data);
+  g_task_set_task_data (task, load, load_data_free);
+  g_task_run_in_thread (task, load_thread);
+  g_object_unref (task);
+}
+
+/* load_time, if not NULL, is set to the microseconds the worker spent
+ * on the image, whether it was decoded or came from the cache.
+ *
+ * Return Value: (transfer full): the wallpaper scaled to cover the
+ * requested size, cropped to it */
+cairo_surface_t *
+maynard_wallpaper_load_finish (GAsyncResult *result,
+    gint64 *load_time,
+    GError **error)
+{
+  LoadData *load = g_task_get_task_data (G_TASK (result));
+
+  if (load_time != NULL)
+    *load_time = load->load_time;
+
+  return g_task_propagate_pointer (G_TASK (result), error);
+}
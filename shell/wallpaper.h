@@ -0,0 +1,40 @@
+/*
+ * Copyright (C) 2014 Collabora Ltd.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA  02110-1301  USA
+ */
+
+#ifndef __MAYNARD_WALLPAPER_H__
+#define __MAYNARD_WALLPAPER_H__
+
+#include <gio/gio.h>
+#include <cairo.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+/* shown until the wallpaper has been loaded, and when there is none */
+#define MAYNARD_WALLPAPER_PLACEHOLDER_RED (70 / 255.0)
+#define MAYNARD_WALLPAPER_PLACEHOLDER_GREEN (130 / 255.0)
+#define MAYNARD_WALLPAPER_PLACEHOLDER_BLUE (180 / 255.0)
+
+void maynard_wallpaper_load_async (const gchar *filename,
+    gint width, gint height, gint scale,
+    GCancellable *cancellable,
+    GAsyncReadyCallback callback, gpointer user_data);
+
+cairo_surface_t * maynard_wallpaper_load_finish (GAsyncResult *result,
+    gint64 *load_time, GError **error);
+
+#endif /* __MAYNARD_WALLPAPER_H__ */